@@ -0,0 +1,187 @@
+//========================================================//
+//  alias.cpp                                             //
+//  Source file for the table aliasing analyzer           //
+//                                                        //
+//  Every entry of the mirrored tables is tagged with the //
+//  PC, history and outcome of its last writer, so each   //
+//  lookup can tell whether another (pc, history) pair    //
+//  last touched the counter and whether that helped or   //
+//  hurt the prediction                                   //
+//========================================================//
+#include <stdio.h>
+#include <string.h>
+#include "predictor.h"
+#include "alias.h"
+#include "sat_counter.h"
+
+//------------------------------------//
+//      Analyzer Configuration        //
+//------------------------------------//
+int aliasMode = 0;
+int aliasMinBits = 10;
+int aliasMaxBits = 20;
+
+//------------------------------------//
+//      Analyzer Data Structures      //
+//------------------------------------//
+
+// The two index functions used by the built-in predictors:
+//   ALIAS_GLOBAL - (pc ^ ghistory), bht_gshare and GlobalPredict
+//   ALIAS_LOCAL  - local history, LocalPredictTable
+#define ALIAS_GLOBAL 0
+#define ALIAS_LOCAL 1
+#define ALIAS_KINDS 2
+
+const char *aliasKindName[ALIAS_KINDS] = {"gshare/GlobalPredict", "LocalPredictTable"};
+
+#define ALIAS_UNWRITTEN 2 // lastOutcome of an entry nobody has trained yet
+
+typedef struct
+{
+  uint8_t *ctr;          // 2-bit counters, same update rule as the real tables
+  uint32_t *lastPC;      // PC of the last branch that trained the entry
+  uint32_t *lastHist;    // history (masked to the index width) of that branch
+  uint8_t *lastOutcome;  // outcome it trained with, or ALIAS_UNWRITTEN
+
+  uint64_t lookups;      // number of conditional branches looked up
+  uint64_t mispredicts;  // mispredictions of this table on its own
+  uint64_t aliased;      // lookups that hit an entry last written by another (pc, history)
+  uint64_t constructive; // aliased, correct, and the last writer pushed the right way
+  uint64_t destructive;  // aliased, wrong, and the last writer pushed the wrong way
+} aliasTable;
+
+aliasTable *aliasTables;   // indexed by (bits - aliasMinBits) * ALIAS_KINDS + kind
+uint64_t alias_ghistory;   // global history, identical to ghistory in gshare
+uint32_t *alias_lhistory;  // local histories, indexed like LocalHistTable
+
+//------------------------------------//
+//        Analyzer Functions          //
+//------------------------------------//
+
+void init_alias()
+{
+  if (aliasMinBits < 1)
+    aliasMinBits = 1;
+  if (aliasMaxBits > 30)
+    aliasMaxBits = 30;
+  if (aliasMaxBits < aliasMinBits)
+    aliasMaxBits = aliasMinBits;
+
+  int sizes = aliasMaxBits - aliasMinBits + 1;
+  aliasTables = (aliasTable *)calloc(sizes * ALIAS_KINDS, sizeof(aliasTable));
+  for (int s = 0; s < sizes; s++)
+  {
+    uint32_t entries = 1u << (aliasMinBits + s);
+    for (int k = 0; k < ALIAS_KINDS; k++)
+    {
+      aliasTable *t = &aliasTables[s * ALIAS_KINDS + k];
+      t->ctr = (uint8_t *)malloc(entries * sizeof(uint8_t));
+      t->lastPC = (uint32_t *)calloc(entries, sizeof(uint32_t));
+      t->lastHist = (uint32_t *)calloc(entries, sizeof(uint32_t));
+      t->lastOutcome = (uint8_t *)malloc(entries * sizeof(uint8_t));
+      memset(t->ctr, WN, entries);
+      memset(t->lastOutcome, ALIAS_UNWRITTEN, entries);
+    }
+  }
+
+  alias_ghistory = 0;
+  alias_lhistory = (uint32_t *)calloc(1u << LocalHist_Bits, sizeof(uint32_t));
+}
+
+// Classify one access to entry 'index' and train it
+//
+static void alias_access(aliasTable *t, uint32_t index, uint32_t pc, uint32_t hist, uint32_t outcome)
+{
+  uint8_t prediction = SatCounter<2>::predict(t->ctr[index]);
+  uint8_t last = t->lastOutcome[index];
+
+  t->lookups++;
+  if (prediction != outcome)
+  {
+    t->mispredicts++;
+  }
+
+  if (last != ALIAS_UNWRITTEN && (t->lastPC[index] != pc || t->lastHist[index] != hist))
+  {
+    t->aliased++;
+    if (prediction != outcome && last != outcome)
+    {
+      t->destructive++;
+    }
+    else if (prediction == outcome && last == outcome)
+    {
+      t->constructive++;
+    }
+  }
+
+  // Update the counter exactly like the real tables do
+  t->ctr[index] = SatCounter<2>::next(t->ctr[index], outcome);
+
+  t->lastPC[index] = pc;
+  t->lastHist[index] = hist;
+  t->lastOutcome[index] = outcome;
+}
+
+void alias_update(uint32_t pc, uint32_t outcome)
+{
+  uint32_t lhtIndex = pc & ((1u << LocalHist_Bits) - 1);
+  uint32_t lhist = alias_lhistory[lhtIndex];
+
+  int sizes = aliasMaxBits - aliasMinBits + 1;
+  for (int s = 0; s < sizes; s++)
+  {
+    uint32_t mask = (1u << (aliasMinBits + s)) - 1;
+    aliasTable *t = &aliasTables[s * ALIAS_KINDS];
+
+    uint32_t ghist = alias_ghistory & mask;
+    alias_access(&t[ALIAS_GLOBAL], (pc ^ ghist) & mask, pc, ghist, outcome);
+    alias_access(&t[ALIAS_LOCAL], lhist & mask, pc, lhist & mask, outcome);
+  }
+
+  alias_ghistory = (alias_ghistory << 1) | outcome;
+  alias_lhistory[lhtIndex] = (lhist << 1) | outcome;
+}
+
+void alias_report()
+{
+  int sizes = aliasMaxBits - aliasMinBits + 1;
+
+  printf("\nAliasing analysis (* = configured size)\n");
+  printf("%-22s %5s %10s %10s %10s %10s %10s %8s\n",
+         "Table", "Bits", "Incorrect", "Aliased", "Constr", "Destr", "Neutral", "Alias%");
+  for (int k = 0; k < ALIAS_KINDS; k++)
+  {
+    for (int s = 0; s < sizes; s++)
+    {
+      int bits = aliasMinBits + s;
+      aliasTable *t = &aliasTables[s * ALIAS_KINDS + k];
+      int configured = (k == ALIAS_GLOBAL) ? (bits == ghistoryBits || bits == GlobalPred_Bits)
+                                           : (bits == LocalPred_Bits);
+
+      // share of this table's mispredictions caused by destructive aliasing
+      float aliasShare = t->mispredicts ? 100 * ((float)t->destructive / (float)t->mispredicts) : 0;
+      printf("%-22s %4d%c %10llu %10llu %10llu %10llu %10llu %7.2f%%\n",
+             aliasKindName[k], bits, configured ? '*' : ' ',
+             (unsigned long long)t->mispredicts,
+             (unsigned long long)t->aliased,
+             (unsigned long long)t->constructive,
+             (unsigned long long)t->destructive,
+             (unsigned long long)(t->aliased - t->constructive - t->destructive),
+             aliasShare);
+    }
+  }
+}
+
+void cleanup_alias()
+{
+  int sizes = aliasMaxBits - aliasMinBits + 1;
+  for (int i = 0; i < sizes * ALIAS_KINDS; i++)
+  {
+    free(aliasTables[i].ctr);
+    free(aliasTables[i].lastPC);
+    free(aliasTables[i].lastHist);
+    free(aliasTables[i].lastOutcome);
+  }
+  free(aliasTables);
+  free(alias_lhistory);
+}
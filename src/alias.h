@@ -0,0 +1,41 @@
+//========================================================//
+//  alias.h                                               //
+//  Header file for the table aliasing analyzer           //
+//                                                        //
+//  Mirrors the gshare/tournament counter tables at a     //
+//  range of sizes and classifies every update as         //
+//  constructive, destructive or neutral aliasing         //
+//========================================================//
+
+#ifndef ALIAS_H
+#define ALIAS_H
+
+#include <stdint.h>
+
+//------------------------------------//
+//      Analyzer Configuration        //
+//------------------------------------//
+extern int aliasMode;    // Non-zero when --alias was given
+extern int aliasMinBits; // Smallest table size analyzed (log2 entries)
+extern int aliasMaxBits; // Largest table size analyzed (log2 entries)
+
+//------------------------------------//
+//    Analyzer Function Prototypes    //
+//------------------------------------//
+
+// Allocate the mirrored tables for every analyzed size
+//
+void init_alias();
+
+// Look up and train every mirrored table with the conditional branch
+// at 'pc', classifying the access before the counter is updated
+//
+void alias_update(uint32_t pc, uint32_t outcome);
+
+// Print the per-table, per-size aliasing breakdown on stdout
+//
+void alias_report();
+
+void cleanup_alias();
+
+#endif
@@ -0,0 +1,161 @@
+//========================================================//
+//  arena.cpp                                             //
+//  Source file for the huge-page table arena             //
+//                                                        //
+//  Chunks are 2 MB (or a multiple) so a THP or hugetlbfs //
+//  chunk is exactly one or more huge pages               //
+//========================================================//
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#include "arena.h"
+
+#define HUGE_PAGE (2u << 20)
+#define ARENA_MAX_ALIGN 4096u // largest 'align' alloc() accepts
+
+int arenaMode = ARENA_THP;
+const char *arenaModeName[] = {"off", "4k", "thp", "hugetlb"};
+
+//------------------------------------//
+//          Arena Functions           //
+//------------------------------------//
+
+void Arena::add_chunk(size_t minBytes)
+{
+  chunk c;
+  c.size = (minBytes + HUGE_PAGE - 1) & ~(size_t)(HUGE_PAGE - 1);
+  c.top = 0;
+  c.mapping = MAP_FAILED;
+  c.backing = arenaMode;
+
+#ifdef MAP_HUGETLB
+  if (c.backing == ARENA_HUGETLB)
+  {
+    c.mapping = mmap(NULL, c.size, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    c.mapped = c.size;
+    c.base = (char *)c.mapping;
+    if (c.mapping == MAP_FAILED)
+      c.backing = ARENA_THP; // no pages reserved in hugetlbfs
+  }
+#endif
+
+  if (c.backing == ARENA_THP)
+  {
+    // over-map by one huge page so the region can start on a 2 MB boundary
+    c.mapped = c.size + HUGE_PAGE;
+    c.mapping = mmap(NULL, c.mapped, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (c.mapping != MAP_FAILED)
+    {
+      c.base = (char *)(((uintptr_t)c.mapping + HUGE_PAGE - 1) & ~(uintptr_t)(HUGE_PAGE - 1));
+#ifdef MADV_HUGEPAGE
+      if (madvise(c.base, c.size, MADV_HUGEPAGE) != 0)
+        c.backing = ARENA_MALLOC; // THP disabled: plain anonymous pages
+#else
+      c.backing = ARENA_MALLOC;
+#endif
+    }
+    else
+    {
+      c.backing = ARENA_MALLOC;
+    }
+  }
+
+  if (c.mapping == MAP_FAILED)
+  {
+    // calloc only aligns to 16 bytes: over-allocate by a page so the
+    // region starts on a 4 KB boundary and alloc() can honour 'align'
+    c.backing = ARENA_MALLOC;
+    c.mapping = calloc(1, c.size + ARENA_MAX_ALIGN);
+    c.mapped = 0; // 0 = free(), not munmap()
+    if (c.mapping == NULL)
+    {
+      fprintf(stderr, "Arena: out of memory allocating %zu bytes\n", c.size);
+      exit(1);
+    }
+    c.base = (char *)(((uintptr_t)c.mapping + ARENA_MAX_ALIGN - 1) & ~(uintptr_t)(ARENA_MAX_ALIGN - 1));
+  }
+
+  chunks = (chunk *)realloc(chunks, (numChunks + 1) * sizeof(chunk));
+  chunks[numChunks++] = c;
+}
+
+void *Arena::alloc(size_t bytes, size_t align)
+{
+  chunk *c = numChunks ? &chunks[numChunks - 1] : NULL;
+  size_t start = c ? (c->top + align - 1) & ~(align - 1) : 0;
+  if (c == NULL || start + bytes > c->size)
+  {
+    // earlier chunks keep their tail free; tables are allocated once at init
+    add_chunk(bytes);
+    c = &chunks[numChunks - 1];
+    start = 0;
+  }
+  c->top = start + bytes;
+  used += bytes;
+  return c->base + start;
+}
+
+int Arena::backing() const
+{
+  int weakest = arenaMode;
+  for (int i = 0; i < numChunks; i++)
+    if (chunks[i].backing < weakest)
+      weakest = chunks[i].backing;
+  return weakest;
+}
+
+void Arena::release()
+{
+  for (int i = 0; i < numChunks; i++)
+  {
+    if (chunks[i].mapped)
+      munmap(chunks[i].mapping, chunks[i].mapped);
+    else
+      free(chunks[i].mapping);
+  }
+  free(chunks);
+  chunks = NULL;
+  numChunks = 0;
+  used = 0;
+}
+
+//------------------------------------//
+//         dTLB Miss Counter          //
+//------------------------------------//
+
+static int dtlbFd = -1;
+
+int dtlb_open()
+{
+  struct perf_event_attr attr;
+  memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = PERF_TYPE_HW_CACHE;
+  attr.config = PERF_COUNT_HW_CACHE_DTLB |
+                (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  dtlbFd = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+  return dtlbFd >= 0;
+}
+
+uint64_t dtlb_read()
+{
+  uint64_t count = 0;
+  if (dtlbFd < 0 || read(dtlbFd, &count, sizeof(count)) != sizeof(count))
+    return 0;
+  return count;
+}
+
+void dtlb_close()
+{
+  if (dtlbFd >= 0)
+    close(dtlbFd);
+  dtlbFd = -1;
+}
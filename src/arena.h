@@ -0,0 +1,68 @@
+//========================================================//
+//  arena.h                                               //
+//  Header file for the huge-page table arena             //
+//                                                        //
+//  Carves a predictor's tables out of 2 MB pages so the  //
+//  whole predictor sits under a handful of dTLB entries  //
+//========================================================//
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+// Backing requested for (and obtained by) an arena chunk
+#define ARENA_OFF 0     // no arena: every table is its own malloc
+#define ARENA_MALLOC 1  // one calloc per chunk, 4 KB pages
+#define ARENA_THP 2     // 2 MB aligned mmap + madvise(MADV_HUGEPAGE)
+#define ARENA_HUGETLB 3 // explicit MAP_HUGETLB pages from hugetlbfs
+
+extern int arenaMode; // best backing to try, --arena:<mode>
+extern const char *arenaModeName[];
+
+// A bump allocator over 2 MB chunks. Every chunk first tries the
+// requested backing and falls back towards ARENA_MALLOC when the
+// kernel has no huge pages to give, so alloc() only fails if memory
+// is exhausted. Allocations are zeroed and never freed individually;
+// release() returns all chunks at once.
+//
+class Arena
+{
+public:
+  Arena() : chunks(NULL), numChunks(0), used(0) {}
+
+  // 'bytes' of zeroed memory aligned to 'align' (a power of two <= 4096)
+  void *alloc(size_t bytes, size_t align = 64);
+  void release();
+
+  // Bytes handed out, and the weakest backing any chunk ended up with
+  size_t bytes() const { return used; }
+  int backing() const;
+
+private:
+  struct chunk
+  {
+    char *base;     // start of the usable (2 MB aligned) region
+    size_t size;    // usable bytes
+    size_t top;     // next free byte
+    void *mapping;  // what to munmap/free
+    size_t mapped;  // length of 'mapping'
+    int backing;
+  };
+  chunk *chunks;
+  int numChunks;
+  size_t used;
+
+  void add_chunk(size_t minBytes);
+};
+
+// dTLB load misses of this thread, from the perf counters.
+// dtlb_open() returns 0 if the counter is not available (no PMU
+// access, e.g. in a VM or with perf_event_paranoid > 2).
+//
+int dtlb_open();
+uint64_t dtlb_read();
+void dtlb_close();
+
+#endif
@@ -0,0 +1,689 @@
+//========================================================//
+//  bench.cpp                                             //
+//  Microbenchmarks for the simulator's hot kernels       //
+//                                                        //
+//  Each benchmark times a kernel against the code it     //
+//  replaced (or a baseline) on synthetic inputs and      //
+//  prints nanoseconds per operation.                     //
+//  Usage: bench [<benchmark> ...]   (default: all)       //
+//========================================================//
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include "predictor.h"
+#include "sat_counter.h"
+#include "packed_array.h"
+#include "arena.h"
+#include "index_stream.h"
+#include "sweep.h"
+#include "isa.h"
+#include "trace.h"
+
+//------------------------------------//
+//          Benchmark Support         //
+//------------------------------------//
+
+#define BENCH_OPS (1 << 24)
+#define BENCH_TABLE_BITS 16
+
+uint32_t *benchIndex;   // random table indices
+uint8_t *benchOutcome;  // outcomes with the requested taken rate
+uint8_t *benchTable;    // 2-bit counters / chooser states
+volatile uint32_t benchSink;
+
+static double now()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static uint64_t benchRng = 0x2545f4914f6cdd1dULL;
+static uint32_t bench_random()
+{
+  benchRng ^= benchRng << 13;
+  benchRng ^= benchRng >> 7;
+  benchRng ^= benchRng << 17;
+  return (uint32_t)benchRng;
+}
+
+// Fill the inputs: random indices, outcomes taken with 'takenPercent' %
+//
+static void bench_inputs(int takenPercent)
+{
+  for (uint32_t i = 0; i < BENCH_OPS; i++)
+  {
+    benchIndex[i] = bench_random() & ((1 << BENCH_TABLE_BITS) - 1);
+    benchOutcome[i] = (bench_random() % 100) < (uint32_t)takenPercent;
+  }
+  for (uint32_t i = 0; i < (1 << BENCH_TABLE_BITS); i++)
+  {
+    benchTable[i] = bench_random() & 3;
+  }
+}
+
+// Time 'kernel' over the inputs, best of three, in ns per operation
+//
+static double bench_time(void (*kernel)())
+{
+  double best = 1e30;
+  for (int rep = 0; rep < 3; rep++)
+  {
+    double start = now();
+    kernel();
+    double elapsed = now() - start;
+    if (elapsed < best)
+      best = elapsed;
+  }
+  return best * 1e9 / BENCH_OPS;
+}
+
+//------------------------------------//
+//      Saturating Counter Kernels    //
+//------------------------------------//
+
+// The switch ladder train_gshare used
+__attribute__((noinline)) static void counter_switch()
+{
+  for (uint32_t i = 0; i < BENCH_OPS; i++)
+  {
+    uint8_t *c = &benchTable[benchIndex[i]];
+    uint8_t outcome = benchOutcome[i];
+    switch (*c)
+    {
+    case WN:
+      *c = (outcome == TAKEN) ? WT : SN;
+      break;
+    case SN:
+      *c = (outcome == TAKEN) ? WN : SN;
+      break;
+    case WT:
+      *c = (outcome == TAKEN) ? ST : WN;
+      break;
+    case ST:
+      *c = (outcome == TAKEN) ? ST : WT;
+      break;
+    }
+  }
+}
+
+// The 8-way if/else chain the TAGE allocation used
+__attribute__((noinline)) static void counter_chain()
+{
+  for (uint32_t i = 0; i < BENCH_OPS; i++)
+  {
+    uint8_t *c = &benchTable[benchIndex[i]];
+    uint8_t outcome = benchOutcome[i];
+    if (outcome == TAKEN && *c == ST)
+      *c = ST;
+    else if (outcome == NOTTAKEN && *c == ST)
+      *c = WT;
+    else if (outcome == TAKEN && *c == WT)
+      *c = ST;
+    else if (outcome == NOTTAKEN && *c == WT)
+      *c = WN;
+    else if (outcome == TAKEN && *c == WN)
+      *c = WT;
+    else if (outcome == NOTTAKEN && *c == WN)
+      *c = SN;
+    else if (outcome == TAKEN && *c == SN)
+      *c = WN;
+    else if (outcome == NOTTAKEN && *c == SN)
+      *c = SN;
+  }
+}
+
+__attribute__((noinline)) static void counter_sat()
+{
+  for (uint32_t i = 0; i < BENCH_OPS; i++)
+  {
+    uint8_t *c = &benchTable[benchIndex[i]];
+    *c = SatCounter<2>::next(*c, benchOutcome[i]);
+  }
+}
+
+//------------------------------------//
+//       Chooser State Kernels        //
+//------------------------------------//
+
+// The switch train_tournament used; 'outcome' stands in for
+// globalCorrect and the index parity for disagreement
+__attribute__((noinline)) static void chooser_switch()
+{
+  for (uint32_t i = 0; i < BENCH_OPS; i++)
+  {
+    uint8_t *c = &benchTable[benchIndex[i]];
+    uint8_t globalCorrect = benchOutcome[i];
+    if (benchIndex[i] & 1)
+    {
+      switch (*c)
+      {
+      case global_strong:
+        *c = globalCorrect ? global_strong : global_weak;
+        break;
+      case global_weak:
+        *c = globalCorrect ? global_strong : local_weak;
+        break;
+      case local_weak:
+        *c = globalCorrect ? global_weak : local_strong;
+        break;
+      case local_strong:
+        *c = globalCorrect ? local_weak : local_strong;
+        break;
+      }
+    }
+  }
+}
+
+__attribute__((noinline)) static void chooser_table()
+{
+  for (uint32_t i = 0; i < BENCH_OPS; i++)
+  {
+    uint8_t *c = &benchTable[benchIndex[i]];
+    *c = ChooserNext[*c][((benchIndex[i] & 1) << 1) | benchOutcome[i]];
+  }
+}
+
+//------------------------------------//
+//        TAGE Tag Match Kernels      //
+//------------------------------------//
+
+// The custom predictor's tagged tables, see predictor.cpp
+extern uint16_t *TageTag[];
+
+// Lookups drawn from a pool of (index, tag) sets, see bench_tage
+uint32_t (*benchTageIndex)[TAGE_TABLES + 1];
+uint16_t (*benchTageTag)[TAGE_TABLES + 1];
+
+// Provider and alternate by comparing one table at a time, longest
+// history first, stopping at the second match
+__attribute__((noinline)) static void tage_sequential()
+{
+  uint32_t sum = 0;
+  for (uint32_t i = 0; i < BENCH_OPS; i++)
+  {
+    const uint32_t *index = benchTageIndex[benchIndex[i]];
+    const uint16_t *tag = benchTageTag[benchIndex[i]];
+    int provider = 0, alt = 0;
+    for (int t = TAGE_TABLES; t >= 1 && alt == 0; t--)
+    {
+      if (TageTag[t][index[t]] == tag[t])
+      {
+        if (provider)
+          alt = t;
+        else
+          provider = t;
+      }
+    }
+    sum += provider + alt;
+  }
+  benchSink = sum;
+}
+
+__attribute__((noinline)) static void tage_mask()
+{
+  uint32_t sum = 0;
+  for (uint32_t i = 0; i < BENCH_OPS; i++)
+  {
+    uint32_t matches = tage_match_mask(benchTageIndex[benchIndex[i]], benchTageTag[benchIndex[i]]);
+    int provider = matches ? 31 - __builtin_clz(matches) : 0;
+    matches &= ~(1u << provider);
+    sum += provider + (matches ? 31 - __builtin_clz(matches) : 0);
+  }
+  benchSink = sum;
+}
+
+//------------------------------------//
+//      Folded History Kernels        //
+//------------------------------------//
+
+// Five folded registers of growing length,
+// with the longest one 'benchHistLen' bits long
+int benchHistLen;
+
+__attribute__((noinline)) static void history_folded()
+{
+  LongHistory h;
+  FoldedHistory fold[5];
+  h.init(benchHistLen + 1);
+  for (int t = 0; t < 5; t++)
+    fold[t].init(benchHistLen >> (4 - t), 9 + t);
+  uint32_t sum = 0;
+  for (uint32_t i = 0; i < BENCH_OPS; i++)
+  {
+    h.push(benchOutcome[i]);
+    for (int t = 0; t < 5; t++)
+    {
+      fold[t].update(h);
+      sum += fold[t].value;
+    }
+  }
+  benchSink = sum;
+  h.release();
+}
+
+//------------------------------------//
+//        Table Arena Kernels         //
+//------------------------------------//
+
+// Many live 2-bit tables, as in a sweep over predictor configurations,
+// updated in turn at random indices
+#define BENCH_ARENA_TABLES 128
+#define BENCH_ARENA_BITS 20 // 256 KB per table, 32 MB in total
+PackedArray<2> benchArenaTable[BENCH_ARENA_TABLES];
+
+__attribute__((noinline)) static void arena_update()
+{
+  for (uint32_t i = 0; i < BENCH_OPS; i++)
+  {
+    uint32_t index = (benchIndex[i] * 0x9e3779b1u) >> (32 - BENCH_ARENA_BITS);
+    benchArenaTable[i % BENCH_ARENA_TABLES].update(index, benchOutcome[i]);
+  }
+}
+
+//------------------------------------//
+//      Lookahead Prefetch Kernels    //
+//------------------------------------//
+
+// The simulation loop of main.cpp over an in-memory trace of
+// conditional branches (trace parsing would hide the table misses),
+// prefetching 'benchDistance' branches ahead
+int benchDistance;
+uint32_t *benchPC;
+
+__attribute__((noinline)) static void prefetch_loop()
+{
+  uint32_t correct = 0;
+  for (uint32_t i = 0; i < BENCH_OPS; i++)
+  {
+    if (benchDistance && i + benchDistance < BENCH_OPS)
+      prefetch_predictor(benchPC[i + benchDistance], benchOutcome[i + benchDistance]);
+    correct += make_prediction(benchPC[i], 0, 1) == benchOutcome[i];
+    train_predictor(benchPC[i], 0, benchOutcome[i], 1, 0, 0, 1);
+  }
+  benchSink = correct;
+}
+
+//------------------------------------//
+//      Block Simulation Kernels      //
+//------------------------------------//
+
+branchRecord *benchRecord; // all conditional, pcs from a pool of 4K
+
+__attribute__((noinline)) static void block_per_branch()
+{
+  uint32_t correct = 0;
+  for (uint32_t i = 0; i < BENCH_OPS; i++)
+  {
+    branchRecord *b = &benchRecord[i];
+    correct += make_prediction(b->pc, b->target, b->direct) == b->outcome;
+    train_predictor(b->pc, b->target, b->outcome, b->condition, b->call, b->ret, b->direct);
+  }
+  benchSink = correct;
+}
+
+__attribute__((noinline)) static void block_simulate()
+{
+  uint32_t correct = 0;
+  uint8_t prediction[BLOCK_BRANCHES];
+  for (uint32_t i = 0; i < BENCH_OPS; i += BLOCK_BRANCHES)
+  {
+    simulate_block(&benchRecord[i], BLOCK_BRANCHES, prediction);
+    for (int j = 0; j < BLOCK_BRANCHES; j++)
+      correct += prediction[j] == benchRecord[i + j].outcome;
+  }
+  benchSink = correct;
+}
+
+//------------------------------------//
+//       Gshare Sweep Kernels         //
+//------------------------------------//
+
+__attribute__((noinline)) static void sweep_pass()
+{
+  for (uint32_t i = 0; i < BENCH_OPS; i++)
+    sweep_update(benchPC[i], benchOutcome[i], 0);
+}
+
+//------------------------------------//
+//            Benchmarks              //
+//------------------------------------//
+
+static void bench_counters()
+{
+  int rates[] = {50, 90};
+  printf("%-28s %8s %10s\n", "counters (ns/update)", "taken%", "ns");
+  for (int r = 0; r < 2; r++)
+  {
+    bench_inputs(rates[r]);
+    printf("%-28s %8d %10.3f\n", "switch ladder", rates[r], bench_time(counter_switch));
+    printf("%-28s %8d %10.3f\n", "if/else chain", rates[r], bench_time(counter_chain));
+    printf("%-28s %8d %10.3f\n", "SatCounter<2>::next", rates[r], bench_time(counter_sat));
+  }
+}
+
+static void bench_chooser()
+{
+  printf("%-28s %8s %10s\n", "chooser (ns/update)", "right%", "ns");
+  bench_inputs(50);
+  printf("%-28s %8d %10.3f\n", "switch", 50, bench_time(chooser_switch));
+  printf("%-28s %8d %10.3f\n", "ChooserNext table", 50, bench_time(chooser_table));
+}
+
+static void bench_tage()
+{
+  // a pool of random lookups, each planted in about half of the tables,
+  // so provider and alternate land on every table (and on none) in an
+  // order the host branch predictor cannot learn
+  init_custom();
+  const uint32_t poolSize = 1 << 12;
+  benchTageIndex = (uint32_t(*)[TAGE_TABLES + 1])malloc(poolSize * sizeof(*benchTageIndex));
+  benchTageTag = (uint16_t(*)[TAGE_TABLES + 1])malloc(poolSize * sizeof(*benchTageTag));
+  for (uint32_t p = 0; p < poolSize; p++)
+  {
+    for (int t = 1; t <= TAGE_TABLES; t++)
+    {
+      benchTageIndex[p][t] = bench_random() & 1023;
+      benchTageTag[p][t] = bench_random() & 0xff;
+      if (bench_random() & 1)
+      {
+        TageTag[t][benchTageIndex[p][t]] = benchTageTag[p][t];
+      }
+    }
+  }
+  for (uint32_t i = 0; i < BENCH_OPS; i++)
+  {
+    benchIndex[i] = bench_random() & (poolSize - 1);
+  }
+
+  printf("%-28s %10s\n", "tage match (ns/lookup)", "ns");
+  printf("%-28s %10.3f\n", "sequential compares", bench_time(tage_sequential));
+  init_isa(ISA_SCALAR);
+  printf("%-28s %10.3f\n", "match mask, scalar", bench_time(tage_mask));
+  init_isa(-1);
+  printf("%-28s %10.3f\n", "match mask, SIMD", bench_time(tage_mask));
+
+  cleanup_custom();
+  free(benchTageIndex);
+  free(benchTageTag);
+}
+
+static void bench_history()
+{
+  int lengths[] = {64, 256, 1024, 2048};
+  printf("%-28s %8s %10s\n", "history (ns/branch, 5 folds)", "bits", "ns");
+  bench_inputs(50);
+  for (int l = 0; l < 4; l++)
+  {
+    benchHistLen = lengths[l];
+    printf("%-28s %8d %10.3f\n", "push + fold updates", lengths[l], bench_time(history_folded));
+  }
+}
+
+static void bench_arena()
+{
+  int modes[] = {ARENA_OFF, ARENA_MALLOC, ARENA_THP, ARENA_HUGETLB};
+  int haveDtlb = dtlb_open();
+  printf("%-28s %8s %10s %12s\n", "arena (ns/update)", "backing", "ns", "dTLB/1000");
+  bench_inputs(50);
+  for (int m = 0; m < 4; m++)
+  {
+    Arena arena;
+    arenaMode = modes[m];
+    for (int t = 0; t < BENCH_ARENA_TABLES; t++)
+      benchArenaTable[t].init(1 << BENCH_ARENA_BITS, WN, modes[m] == ARENA_OFF ? NULL : &arena);
+    uint64_t dtlbStart = dtlb_read();
+    double ns = bench_time(arena_update);
+    uint64_t dtlbMisses = dtlb_read() - dtlbStart;
+
+    printf("%-28s %8s %10.3f ", arenaModeName[modes[m]],
+           modes[m] == ARENA_OFF ? "malloc" : arenaModeName[arena.backing()], ns);
+    if (haveDtlb)
+      printf("%12.3f\n", 1000.0 * dtlbMisses / (3.0 * BENCH_OPS));
+    else
+      printf("%12s\n", "n/a");
+
+    for (int t = 0; t < BENCH_ARENA_TABLES; t++)
+      benchArenaTable[t].release();
+    arena.release();
+  }
+  arenaMode = ARENA_THP;
+  dtlb_close();
+}
+
+static void bench_prefetch()
+{
+  // random outcomes make the global history, and so every gshare/global
+  // index, random; tables of 2^24-2^26 entries (4-16 MB) miss in the LLC
+  int distances[] = {0, 4, 8, 16, 32, 64};
+  benchPC = (uint32_t *)malloc(BENCH_OPS * sizeof(uint32_t));
+  bench_inputs(50);
+  for (uint32_t i = 0; i < BENCH_OPS; i++)
+    benchPC[i] = 0x400000 + (benchIndex[i] & 0xfff) * 4;
+
+  printf("%-28s %8s %10s\n", "prefetch (ns/branch)", "distance", "ns");
+  for (int p = 0; p < 2; p++)
+  {
+    if (p == 0)
+    {
+      bpType = GSHARE;
+      ghistoryBits = 26;
+    }
+    else
+    {
+      bpType = TOURNAMENT;
+      GlobalPred_Bits = 24;
+      ChooserBits = 24;
+    }
+    for (int d = 0; d < 6; d++)
+    {
+      init_predictor();
+      benchDistance = distances[d];
+      printf("%-28s %8d %10.3f\n", bpName[bpType], distances[d], bench_time(prefetch_loop));
+      cleanup_predictor();
+    }
+  }
+  free(benchPC);
+  ghistoryBits = 17;
+  GlobalPred_Bits = 16;
+  ChooserBits = 12;
+}
+
+static void bench_block()
+{
+  benchRecord = (branchRecord *)calloc(BENCH_OPS, sizeof(branchRecord));
+  bench_inputs(70);
+  for (uint32_t i = 0; i < BENCH_OPS; i++)
+  {
+    benchRecord[i].pc = 0x400000 + (benchIndex[i] & 0xfff) * 4;
+    benchRecord[i].outcome = benchOutcome[i];
+    benchRecord[i].condition = 1;
+    benchRecord[i].direct = 1;
+  }
+
+  printf("%-28s %8s %10s\n", "block (ns/branch)", "isa", "ns");
+  int types[] = {GSHARE, TOURNAMENT};
+  for (int p = 0; p < 2; p++)
+  {
+    bpType = types[p];
+    init_predictor();
+    printf("%-28s %8s %10.3f\n", bpName[bpType], "per-br", bench_time(block_per_branch));
+    cleanup_predictor();
+    init_predictor();
+    printf("%-28s %8s %10.3f\n", bpName[bpType], block_index_isa(), bench_time(block_simulate));
+    cleanup_predictor();
+  }
+  free(benchRecord);
+}
+
+static void bench_perceptron()
+{
+  // gshare's block path against the perceptron's (dot product and training
+  // step) and the multiperspective one's (hashing and weight sum), with
+  // each instruction set
+  benchRecord = (branchRecord *)calloc(BENCH_OPS, sizeof(branchRecord));
+  bench_inputs(70);
+  for (uint32_t i = 0; i < BENCH_OPS; i++)
+  {
+    benchRecord[i].pc = 0x400000 + (benchIndex[i] & 0xfff) * 4;
+    benchRecord[i].outcome = benchOutcome[i];
+    benchRecord[i].condition = 1;
+    benchRecord[i].direct = 1;
+  }
+
+  printf("%-28s %8s %10s\n", "perceptron (ns/branch)", "isa", "ns");
+  bpType = GSHARE;
+  init_predictor();
+  printf("%-28s %8s %10.3f\n", bpName[bpType], block_index_isa(), bench_time(block_simulate));
+  cleanup_predictor();
+
+  int types[] = {PERCEPTRON, MULTIPERSPECTIVE};
+  int host = init_isa(-1);
+  for (int p = 0; p < 2; p++)
+  {
+    bpType = types[p];
+    for (int isa = ISA_SCALAR; isa <= ISA_AVX2 && isa <= host; isa++)
+    {
+      init_isa(isa);
+      init_predictor();
+      printf("%-28s %8s %10.3f\n", bpName[bpType], isaName[activeIsa], bench_time(block_simulate));
+      cleanup_predictor();
+    }
+  }
+  init_isa(-1);
+  free(benchRecord);
+}
+
+static void bench_sweep()
+{
+  // 16 configurations: a 2^15 entry table with history 0..15, either
+  // simulated one trace pass each or all in one pass of the sweep lanes
+  benchPC = (uint32_t *)malloc(BENCH_OPS * sizeof(uint32_t));
+  bench_inputs(70);
+  for (uint32_t i = 0; i < BENCH_OPS; i++)
+    benchPC[i] = 0x400000 + (benchIndex[i] & 0xfff) * 4;
+
+  printf("%-28s %8s %10s\n", "sweep (ns/branch/config)", "configs", "ns");
+  bpType = GSHARE;
+  ghistoryBits = 15;
+  init_predictor();
+  benchDistance = 0;
+  printf("%-28s %8d %10.3f\n", "gshare, a pass per config", 1, bench_time(prefetch_loop));
+  cleanup_predictor();
+  ghistoryBits = 17;
+
+  sweepMinBits = sweepMaxBits = 15;
+  sweepHistStep = 1;
+  init_sweep();
+  printf("%-28s %8d %10.3f\n", sweep_isa(), 16, bench_time(sweep_pass) / 16);
+  cleanup_sweep();
+  free(benchPC);
+}
+
+//------------------------------------//
+//            Trace Parsing           //
+//------------------------------------//
+
+#define BENCH_LINE 48 // room for the longest generated line
+char *benchText;     // BENCH_OPS trace lines
+
+__attribute__((noinline)) static void parse_sscanf()
+{
+  uint32_t pc, target, outcome, condition, call, ret, direct, sum = 0;
+  char line[BENCH_LINE];
+  const char *p = benchText;
+  for (uint32_t i = 0; i < BENCH_OPS; i++)
+  {
+    // sscanf takes the strlen of its input, so give it the one line as getline did
+    const char *end = strchr(p, '\n') + 1;
+    memcpy(line, p, end - p);
+    line[end - p] = '\0';
+    sscanf(line, "0x%x\t0x%x\t%d\t%d\t%d\t%d\t%d", &pc, &target, &outcome, &condition, &call, &ret, &direct);
+    p = end;
+    sum += pc + outcome;
+  }
+  benchSink = sum;
+}
+
+__attribute__((noinline)) static void parse_lines()
+{
+  branchRecord b;
+  uint32_t sum = 0;
+  const char *p = benchText;
+  for (uint32_t i = 0; i < BENCH_OPS; i++)
+  {
+    p = trace_parse_line(p, &b);
+    sum += b.pc + b.outcome;
+  }
+  benchSink = sum;
+}
+
+static void bench_parse()
+{
+  benchText = (char *)malloc((size_t)BENCH_OPS * BENCH_LINE);
+  bench_inputs(50);
+  char *p = benchText;
+  for (uint32_t i = 0; i < BENCH_OPS; i++)
+  {
+    uint32_t pc = 0x400000 + (benchIndex[i] & 0xfffff) * 4;
+    p += sprintf(p, "0x%x\t0x%x\t%d\t1\t0\t0\t1\n", pc, pc + 64, benchOutcome[i]);
+  }
+  memset(p, 0, 32);
+
+  printf("%-28s %8s %10s\n", "parse (ns/line)", "isa", "ns");
+  printf("%-28s %8s %10.3f\n", "sscanf", "-", bench_time(parse_sscanf));
+  int host = init_isa(-1);
+  for (int isa = ISA_SCALAR; isa <= host; isa++)
+  {
+    init_isa(isa);
+    printf("%-28s %8s %10.3f\n", "trace_parse_line", isaName[activeIsa], bench_time(parse_lines));
+  }
+  init_isa(-1);
+  free(benchText);
+}
+
+typedef struct
+{
+  const char *name;
+  void (*run)();
+} benchCase;
+
+benchCase benchCases[] = {
+    {"counters", bench_counters},
+    {"chooser", bench_chooser},
+    {"tage", bench_tage},
+    {"history", bench_history},
+    {"arena", bench_arena},
+    {"prefetch", bench_prefetch},
+    {"block", bench_block},
+    {"perceptron", bench_perceptron},
+    {"sweep", bench_sweep},
+    {"parse", bench_parse},
+};
+#define NUM_BENCH (sizeof(benchCases) / sizeof(benchCases[0]))
+
+int main(int argc, char *argv[])
+{
+  benchIndex = (uint32_t *)malloc(BENCH_OPS * sizeof(uint32_t));
+  benchOutcome = (uint8_t *)malloc(BENCH_OPS * sizeof(uint8_t));
+  benchTable = (uint8_t *)malloc((1 << BENCH_TABLE_BITS) * sizeof(uint8_t));
+
+  for (size_t b = 0; b < NUM_BENCH; b++)
+  {
+    int selected = (argc == 1);
+    for (int i = 1; i < argc; i++)
+      selected |= !strcmp(argv[i], benchCases[b].name);
+    if (selected)
+    {
+      benchCases[b].run();
+      printf("\n");
+    }
+  }
+
+  free(benchIndex);
+  free(benchOutcome);
+  free(benchTable);
+  return 0;
+}
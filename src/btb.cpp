@@ -0,0 +1,262 @@
+//========================================================//
+//  btb.cpp                                               //
+//  Source file for the branch target buffer and return   //
+//  address stack                                         //
+//                                                        //
+//  Struct of arrays: a set's tags sit in one 64-byte     //
+//  line (up to 32 ways), its targets and ages in others, //
+//  so a lookup touches one line until a tag matches      //
+//========================================================//
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <emmintrin.h>
+#include "btb.h"
+
+//------------------------------------//
+//        BTB Configuration           //
+//------------------------------------//
+const char *btbPolicyName[3] = {"lru", "fifo", "random"};
+const char *rasOverflowName[2] = {"wrap", "drop"};
+
+int btbMode = 0;
+int btbEntries = 4096;
+int btbWays = 4;
+int btbPolicy = BTB_LRU;
+int rasDepth = 16;
+int rasOverflow = RAS_WRAP;
+
+//------------------------------------//
+//        BTB Data Structures         //
+//------------------------------------//
+
+int btbSetBits;
+uint16_t *btbTag;    // set s's ways at s * btbWays
+uint32_t *btbTarget;
+uint8_t *btbAge;     // LRU: 0 = most recently used
+uint32_t *btbValid;  // one bit per way, per set
+uint8_t *btbFifo;    // FIFO: next way to replace, per set
+uint32_t btbRandom;  // xorshift state for BTB_RANDOM
+
+uint32_t *rasStack;  // call pcs, circular
+int rasTop;          // index of the newest entry
+int rasCount;        // entries held, at most rasDepth
+
+uint64_t btbTaken;       // taken branches looked up
+uint64_t btbMisses;      // not in the BTB
+uint64_t btbWrongTarget; // in the BTB with another target (returns excluded)
+uint64_t rasReturns;
+uint64_t rasMispredicts;
+uint64_t rasOverflows;
+uint64_t rasUnderflows;
+
+//------------------------------------//
+//          BTB Functions             //
+//------------------------------------//
+
+int parse_btb_policy(const char *name)
+{
+  for (int p = 0; p < 3; p++)
+  {
+    if (!strcmp(name, btbPolicyName[p]))
+      return p;
+  }
+  return -1;
+}
+
+int parse_ras_overflow(const char *name)
+{
+  for (int p = 0; p < 2; p++)
+  {
+    if (!strcmp(name, rasOverflowName[p]))
+      return p;
+  }
+  return -1;
+}
+
+void init_btb()
+{
+  int sets = btbEntries / btbWays;
+  btbSetBits = 0;
+  while ((1 << btbSetBits) < sets)
+    btbSetBits++;
+  // padded so btb_match can read 8 tags from the last set of fewer ways
+  size_t tagBytes = ((btbEntries * sizeof(uint16_t) + 16 + 63) / 64) * 64;
+  btbTag = (uint16_t *)aligned_alloc(64, tagBytes);
+  btbTarget = (uint32_t *)calloc(btbEntries, sizeof(uint32_t));
+  btbAge = (uint8_t *)malloc(btbEntries);
+  btbValid = (uint32_t *)calloc(sets, sizeof(uint32_t));
+  btbFifo = (uint8_t *)calloc(sets, 1);
+  memset(btbTag, 0, tagBytes);
+  for (int i = 0; i < btbEntries; i++)
+    btbAge[i] = i % btbWays; // distinct ages per set
+  btbRandom = 0x2545F491;
+
+  rasStack = (uint32_t *)calloc(rasDepth, sizeof(uint32_t));
+  rasTop = 0;
+  rasCount = 0;
+
+  btbTaken = btbMisses = btbWrongTarget = 0;
+  rasReturns = rasMispredicts = rasOverflows = rasUnderflows = 0;
+}
+
+// Make 'way' of set 's' the most recently used
+static inline void btb_touch(uint32_t s, int way)
+{
+  uint8_t *age = btbAge + s * btbWays;
+  uint8_t old = age[way];
+  if (old == 0) // already the most recent, the usual case in loops
+    return;
+  for (int w = 0; w < btbWays; w++)
+    age[w] += age[w] < old;
+  age[way] = 0;
+}
+
+// Valid ways of a set whose tag is 'tag', one bit per way: 8 ways per
+// SSE2 compare (baseline on x86-64, so no isa.h dispatch)
+static inline uint32_t btb_match(const uint16_t *tags, uint16_t tag, uint32_t valid)
+{
+  __m128i t = _mm_set1_epi16(tag);
+  uint32_t hits = 0;
+  for (int w = 0; w < btbWays; w += 8)
+  {
+    __m128i eq = _mm_cmpeq_epi16(_mm_loadu_si128((const __m128i *)(tags + w)), t);
+    hits |= (uint32_t)(_mm_movemask_epi8(_mm_packs_epi16(eq, _mm_setzero_si128())) & 0xFF) << w;
+  }
+  return hits & valid;
+}
+
+static int btb_victim(uint32_t s)
+{
+  uint32_t valid = btbValid[s];
+  if (valid != (btbWays == 32 ? 0xFFFFFFFFu : (1u << btbWays) - 1))
+    return __builtin_ctz(~valid); // a free way first
+  switch (btbPolicy)
+  {
+  case BTB_FIFO:
+  {
+    int way = btbFifo[s];
+    btbFifo[s] = (way + 1) & (btbWays - 1);
+    return way;
+  }
+  case BTB_RANDOM:
+    btbRandom ^= btbRandom << 13;
+    btbRandom ^= btbRandom >> 17;
+    btbRandom ^= btbRandom << 5;
+    return btbRandom & (btbWays - 1);
+  default: // BTB_LRU: the oldest way
+  {
+    const uint8_t *age = btbAge + s * btbWays;
+    for (int w = 0; w < btbWays; w++)
+    {
+      if (age[w] == btbWays - 1)
+        return w;
+    }
+    return 0;
+  }
+  }
+}
+
+static int btb_access(uint32_t pc, uint32_t target, int ret)
+{
+  uint32_t s = pc & ((1 << btbSetBits) - 1);
+  uint16_t tag = (pc >> btbSetBits) & ((1 << BTB_TAG_BITS) - 1);
+  uint32_t hits = btb_match(btbTag + s * btbWays, tag, btbValid[s]);
+  btbTaken++;
+  if (hits)
+  {
+    int w = __builtin_ctz(hits);
+    uint32_t i = s * btbWays + w;
+    int found = 0;
+    if (!ret && btbTarget[i] != target) // returns take their target from the stack
+    {
+      btbWrongTarget++;
+      btbTarget[i] = target;
+      found = BTB_WRONG;
+    }
+    if (btbPolicy == BTB_LRU)
+      btb_touch(s, w);
+    return found;
+  }
+
+  btbMisses++;
+  int way = btb_victim(s);
+  uint32_t i = s * btbWays + way;
+  btbTag[i] = tag;
+  btbTarget[i] = target;
+  btbValid[s] |= 1u << way;
+  if (btbPolicy == BTB_LRU)
+    btb_touch(s, way);
+  return BTB_MISSED;
+}
+
+static void ras_push(uint32_t pc)
+{
+  if (rasCount == rasDepth)
+  {
+    rasOverflows++;
+    if (rasOverflow == RAS_DROP)
+      return;
+    rasCount--; // RAS_WRAP: the oldest entry is overwritten
+  }
+  rasTop = (rasTop + 1) % rasDepth;
+  rasStack[rasTop] = pc;
+  rasCount++;
+}
+
+static int ras_pop(uint32_t target)
+{
+  rasReturns++;
+  if (rasCount == 0)
+  {
+    rasUnderflows++;
+    rasMispredicts++;
+    return RAS_WRONG;
+  }
+  uint32_t call = rasStack[rasTop];
+  rasTop = (rasTop + rasDepth - 1) % rasDepth;
+  rasCount--;
+  int wrong = !(target > call && target - call <= RAS_CALL_MAX_LENGTH);
+  rasMispredicts += wrong;
+  return wrong ? RAS_WRONG : 0;
+}
+
+int btb_update(const branchRecord &b)
+{
+  int found = 0;
+  if (b.outcome || !b.condition)
+    found = btb_access(b.pc, b.target, b.ret);
+  if (b.call)
+    ras_push(b.pc);
+  if (b.ret)
+    found |= ras_pop(b.target);
+  return found;
+}
+
+void btb_report(uint64_t instructions, uint64_t records)
+{
+  uint64_t per = instructions ? instructions : records;
+  const char *unit = instructions ? "instructions" : "records";
+  printf("\nBTB: %d entries, %d-way, %s\n", btbEntries, btbWays, btbPolicyName[btbPolicy]);
+  printf("  taken branches:  %10llu\n", (unsigned long long)btbTaken);
+  printf("  misses:          %10llu  (%.3f per 1000 %s)\n", (unsigned long long)btbMisses,
+         1000.0 * btbMisses / (per ? per : 1), unit);
+  printf("  wrong targets:   %10llu  (%.3f per 1000 %s)\n", (unsigned long long)btbWrongTarget,
+         1000.0 * btbWrongTarget / (per ? per : 1), unit);
+  printf("RAS: %d entries, %s on overflow\n", rasDepth, rasOverflowName[rasOverflow]);
+  printf("  returns:         %10llu\n", (unsigned long long)rasReturns);
+  printf("  mispredicts:     %10llu  (%.3f per 1000 %s)\n", (unsigned long long)rasMispredicts,
+         1000.0 * rasMispredicts / (per ? per : 1), unit);
+  printf("  overflows:       %10llu\n", (unsigned long long)rasOverflows);
+  printf("  underflows:      %10llu\n", (unsigned long long)rasUnderflows);
+}
+
+void cleanup_btb()
+{
+  free(btbTag);
+  free(btbTarget);
+  free(btbAge);
+  free(btbValid);
+  free(btbFifo);
+  free(rasStack);
+}
@@ -0,0 +1,100 @@
+//========================================================//
+//  btb.h                                                 //
+//  Header file for the branch target buffer and return   //
+//  address stack                                         //
+//                                                        //
+//  A set-associative BTB of taken branch targets and a   //
+//  return stack fed by the trace's call and ret flags    //
+//========================================================//
+
+#ifndef BTB_H
+#define BTB_H
+
+#include <stdint.h>
+#include "predictor.h"
+#include "budget.h"
+
+//------------------------------------//
+//        BTB Configuration           //
+//------------------------------------//
+
+// Replacement policies
+#define BTB_LRU 0
+#define BTB_FIFO 1
+#define BTB_RANDOM 2
+extern const char *btbPolicyName[3]; // "lru", "fifo", "random"
+
+// Return stack overflow handling: overwrite the oldest entry, or drop
+// the push (the returns past the stack's depth then pop older frames)
+#define RAS_WRAP 0
+#define RAS_DROP 1
+extern const char *rasOverflowName[2]; // "wrap", "drop"
+
+#define BTB_MAX_WAYS 32
+#define BTB_TAG_BITS 16    // partial tags
+#define BTB_TARGET_BITS 32
+#define RAS_MAX_DEPTH 1024
+
+// A return is predicted right when it lands within one instruction
+// after its call: the trace has no instruction lengths, and x86 ones
+// are at most 15 bytes
+#define RAS_CALL_MAX_LENGTH 15
+
+extern int btbMode;    // Non-zero when --btb or --ras was given
+extern int btbEntries; // power of two
+extern int btbWays;    // power of two, at most BTB_MAX_WAYS
+extern int btbPolicy;
+extern int rasDepth;
+extern int rasOverflow;
+
+// Parse a policy or overflow name, -1 if unknown
+int parse_btb_policy(const char *name);
+int parse_ras_overflow(const char *name);
+
+// Tags, targets, valid bits and replacement state (log2(ways) bits per
+// entry for LRU ages, per set for the FIFO pointer), then the return
+// stack and its top pointer
+constexpr Budget<6> btb_budget(int entries, int ways, int policy, int depth)
+{
+  int wayBits = 0;
+  while ((1 << wayBits) < ways)
+    wayBits++;
+  int topBits = 0;
+  while ((1 << topBits) < depth)
+    topBits++;
+  return {{{"BtbTag", (uint64_t)entries, BTB_TAG_BITS},
+           {"BtbTarget", (uint64_t)entries, BTB_TARGET_BITS},
+           {"BtbValid", (uint64_t)entries, 1},
+           {policy == BTB_LRU ? "BtbAge" : "BtbFifo",
+            policy == BTB_LRU ? (uint64_t)entries : policy == BTB_FIFO ? (uint64_t)(entries / ways) : 0,
+            (uint32_t)wayBits},
+           {"RasStack", (uint64_t)depth, BTB_TARGET_BITS},
+           {"RasTop", 1, (uint32_t)topBits}}};
+}
+
+//------------------------------------//
+//      BTB Function Prototypes       //
+//------------------------------------//
+
+void init_btb();
+
+// What btb_update found for a record
+#define BTB_MISSED 1 // taken, but not in the BTB
+#define BTB_WRONG 2  // in the BTB with another target (not for returns)
+#define RAS_WRONG 4  // a return the stack mispredicted
+
+// Look up and train the BTB with every taken branch, and push / pop
+// the return stack on calls and returns
+//
+// Returns the BTB_ and RAS_ flags for 'b'
+//
+int btb_update(const branchRecord &b);
+
+// Print BTB misses and return mispredictions per 1000 instructions,
+// or per 1000 trace records when 'instructions' is 0 (unknown)
+//
+void btb_report(uint64_t instructions, uint64_t records);
+
+void cleanup_btb();
+
+#endif
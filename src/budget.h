@@ -0,0 +1,66 @@
+//========================================================//
+//  budget.h                                              //
+//  Hardware budget accounting for the predictors         //
+//                                                        //
+//  A predictor lists its tables and registers as budget  //
+//  items; the sum is a constexpr, so a default           //
+//  configuration over budget fails to compile, and the   //
+//  same list built from the runtime sizes is printed     //
+//========================================================//
+
+#ifndef BUDGET_H
+#define BUDGET_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+// 256 Kbit of tables plus 1024 bits of registers and other state
+#define BUDGET_BITS (256 * 1024 + 1024)
+
+// One table or register: 'entries' fields of 'width' bits
+struct BudgetItem
+{
+  const char *name;
+  uint64_t entries;
+  uint32_t width;
+
+  constexpr uint64_t bits() const { return entries * width; }
+};
+
+// Field width of a table, from the type it is stored in (PackedArray<W>)
+template <typename T>
+constexpr uint32_t field_width(const T &)
+{
+  return T::WIDTH;
+}
+
+template <int N>
+struct Budget
+{
+  BudgetItem item[N];
+
+  constexpr uint64_t bits() const
+  {
+    uint64_t total = 0;
+    for (int i = 0; i < N; i++)
+      total += item[i].bits();
+    return total;
+  }
+
+  constexpr bool fits() const { return bits() <= BUDGET_BITS; }
+
+  void print(const char *predictor) const
+  {
+    printf("Budget: %s, %llu of %d bits%s\n", predictor, (unsigned long long)bits(), BUDGET_BITS,
+           fits() ? "" : " (OVER BUDGET)");
+    for (int i = 0; i < N; i++)
+    {
+      if (item[i].entries == 0)
+        continue;
+      printf("  %-22s %8llu x %4u %10llu\n", item[i].name, (unsigned long long)item[i].entries,
+             item[i].width, (unsigned long long)item[i].bits());
+    }
+  }
+};
+
+#endif
@@ -0,0 +1,29 @@
+#!/usr/bin/env bash
+#
+# Check every bundled trace and predictor against the golden
+# prediction-stream digests, or regenerate them with "update".
+#
+#   ./check_digests.sh            # check, exit status 1 on any mismatch
+#   ./check_digests.sh update     # rewrite ../traces/golden_digests.txt
+#                                 # and ../traces/golden_digests/
+#
+# Extra arguments are passed through to the predictor.
+
+cd "$(dirname "$0")"
+
+mode=--digest
+if [ "$1" == "update" ]; then
+  mode=--digest-update
+  shift
+fi
+
+predictors=${PREDICTORS:-"static gshare tournament custom perceptron mpp"}
+status=0
+for trace in ../traces/*.bz2; do
+  name=$(basename "$trace" .bz2)
+  for predictor in $predictors; do
+    bunzip2 -kc "$trace" | ./predictor --$predictor $mode:$name "$@" | grep '^Digest' || status=1
+    [ ${PIPESTATUS[1]} -eq 0 ] || status=1
+  done
+done
+exit $status
@@ -0,0 +1,40 @@
+#!/usr/bin/env bash
+#
+# Check the gshare sweep once its tables pass 2 GiB (--sweep:27:28:4
+# holds about 3 GiB): every instruction set must finish and report
+# the same mispredictions as the scalar lanes, on the head of a
+# bundled trace.
+#
+#   ./check_sweep.sh              # exit status 1 on any difference
+#
+# Extra arguments are passed through to the predictor.
+
+cd "$(dirname "$0")"
+
+trace=$(mktemp)
+trap 'rm -f "$trace"' EXIT
+bunzip2 -kc ../traces/lbm.bz2 | head -n 200000 > "$trace"
+
+sweep() {
+  # drop the header naming the instruction set
+  ./predictor --static --sweep:27:28:4 --force-isa:$1 "${@:2}" "$trace" | grep -v lanes
+  return ${PIPESTATUS[0]}
+}
+
+status=0
+expected=$(sweep scalar "$@") || status=1
+for isa in avx2 avx512; do
+  actual=$(sweep $isa "$@")
+  rc=$?
+  if [ $rc -ne 0 ]; then
+    echo "$isa: exit status $rc"
+    status=1
+  elif [ "$expected" == "$actual" ]; then
+    echo "$isa: OK"
+  else
+    echo "$isa: differs from the scalar sweep"
+    diff <(echo "$expected") <(echo "$actual")
+    status=1
+  fi
+done
+exit $status
@@ -0,0 +1,34 @@
+#!/usr/bin/env bash
+#
+# Check the trace reader on lines longer than its 256-byte refill
+# margin: the head of a bundled trace with every tenth line padded
+# past 1000 bytes must give the same results as the plain one, with
+# the scalar and the vector parser.
+#
+#   ./check_trace.sh              # exit status 1 on any difference
+#
+# Extra arguments are passed through to the predictor.
+
+cd "$(dirname "$0")"
+
+plain=$(mktemp)
+padded=$(mktemp)
+trap 'rm -f "$plain" "$padded"' EXIT
+
+# 4 MB of lines, so long lines straddle several buffer refills
+bunzip2 -kc ../traces/lbm.bz2 | head -n 120000 > "$plain"
+awk 'NR % 10 == 0 { printf "%s\t%1000s\n", $0, ""; next } { print }' "$plain" > "$padded"
+
+status=0
+for isa in scalar avx512; do
+  expected=$(./predictor --gshare --force-isa:$isa "$@" "$plain") || status=1
+  actual=$(./predictor --gshare --force-isa:$isa "$@" "$padded") || status=1
+  if [ "$expected" == "$actual" ]; then
+    echo "$isa: OK"
+  else
+    echo "$isa: padded trace differs"
+    diff <(echo "$expected") <(echo "$actual")
+    status=1
+  fi
+done
+exit $status
@@ -0,0 +1,65 @@
+//========================================================//
+//  delay_queue.h                                         //
+//  Fixed-latency queue of pending predictor updates      //
+//                                                        //
+//  Holds the last 'delay' updates; pushing one more      //
+//  hands back the oldest, which is then due to retire    //
+//========================================================//
+
+#ifndef DELAY_QUEUE_H
+#define DELAY_QUEUE_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+// A ring of exactly 'delay' slots: once it is full every push
+// overwrites the oldest slot after copying it out, so an update
+// retires 'delay' pushes after its own, in O(1) with no moves.
+//
+template <typename T>
+class DelayQueue
+{
+public:
+  DelayQueue() : slot(NULL), delay(0), head(0), count(0) {}
+
+  void init(int n)
+  {
+    delay = n;
+    slot = (T *)malloc(sizeof(T) * (n > 0 ? n : 1));
+    head = 0;
+    count = 0;
+  }
+
+  // Queue 'u'; returns 1 and the update due now in 'due' once
+  // 'delay' updates are already in flight
+  int shift(const T &u, T *due)
+  {
+    if (count < delay)
+    {
+      slot[(head + count++) % delay] = u;
+      return 0;
+    }
+    *due = slot[head];
+    slot[head] = u;
+    head = head + 1 == delay ? 0 : head + 1;
+    return 1;
+  }
+
+  // Updates still in flight (dropped at the end of the trace)
+  int pending() const { return count; }
+
+  void release()
+  {
+    free(slot);
+    slot = NULL;
+    count = 0;
+  }
+
+private:
+  T *slot;
+  int delay;
+  int head;  // oldest update
+  int count; // up to 'delay'
+};
+
+#endif
@@ -0,0 +1,384 @@
+//========================================================//
+//  digest.cpp                                            //
+//  Source file for the golden prediction-stream digests  //
+//                                                        //
+//  Golden file format, one line per trace and predictor: //
+//    <trace> <predictor> <branches> <incorrect> <hash>   //
+//    <n> <checkpoint 1> ... <checkpoint n>               //
+//  A checkpoint is the running hash after every          //
+//  2^DIGEST_CHECKPOINT_BITS branches, which narrows a    //
+//  mismatch down to the window it started in            //
+//                                                        //
+//  Next to it, <golden>/<trace>.<predictor> lists the    //
+//  branches whose golden prediction differs from a       //
+//  reference (a byte naming it, then varint gaps), from  //
+//  which a check names the exact first divergent branch //
+//========================================================//
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <string>
+#include <vector>
+#include "predictor.h"
+#include "digest.h"
+
+//------------------------------------//
+//       Digest Configuration         //
+//------------------------------------//
+int digestMode = DIGEST_OFF;
+const char *digestFile = "../traces/golden_digests.txt";
+const char *digestTrace = NULL;
+const char *digestBits = NULL;
+
+//------------------------------------//
+//       Digest Data Structures       //
+//------------------------------------//
+uint64_t digestWord;
+uint64_t digestOutcomes;
+uint64_t digestCount;
+uint64_t digestHash;
+std::vector<uint64_t> digestCheckpoints;
+
+// Raw bitstream: written when digestBits does not exist yet,
+// otherwise compared word by word for the exact first divergence
+FILE *digestBitsStream;
+int digestBitsReading;
+int64_t digestFirstDiff; // -1 until a divergent branch is found
+
+// Golden exception list: recorded against both references on update
+// and stored against the shorter one, replayed word by word on check
+std::vector<uint8_t> digestExceptions[2];
+uint64_t digestExceptIndex[2]; // branch after the last exception
+int digestExceptLoaded;
+int digestRef;
+size_t digestExceptPos;
+uint64_t digestNextException; // UINT64_MAX after the last one
+int64_t digestGoldenDiff;     // -1 until a divergent branch is found
+
+//------------------------------------//
+//         Digest Functions           //
+//------------------------------------//
+
+static uint64_t digest_mix(uint64_t hash, uint64_t word)
+{
+  hash = (hash ^ word) * 0x9e3779b97f4a7c15ULL;
+  return hash ^ (hash >> 32);
+}
+
+// <golden file without extension>/<trace>.<predictor>
+//
+static std::string digest_exception_path()
+{
+  std::string path = digestFile;
+  size_t dot = path.rfind('.');
+  if (dot != std::string::npos && path.find('/', dot) == std::string::npos)
+    path.resize(dot);
+  return path + "/" + digestTrace + "." + bpName[bpType];
+}
+
+// Decode the next golden exception
+//
+static void digest_next_exception()
+{
+  std::vector<uint8_t> &list = digestExceptions[0];
+  if (digestExceptPos >= list.size())
+  {
+    digestNextException = UINT64_MAX;
+    return;
+  }
+  uint64_t gap = 0;
+  int shift = 0;
+  uint8_t byte;
+  do
+  {
+    byte = list[digestExceptPos++];
+    gap |= (uint64_t)(byte & 127) << shift;
+    shift += 7;
+  } while ((byte & 128) && digestExceptPos < list.size());
+  digestNextException = digestExceptIndex[0] + gap;
+  digestExceptIndex[0] = digestNextException + 1;
+}
+
+static void digest_load_exceptions()
+{
+  FILE *stream = fopen(digest_exception_path().c_str(), "rb");
+  if (stream == NULL)
+    return;
+  int ref = fgetc(stream);
+  uint8_t buffer[65536];
+  size_t got;
+  while ((got = fread(buffer, 1, sizeof(buffer), stream)) > 0)
+    digestExceptions[0].insert(digestExceptions[0].end(), buffer, buffer + got);
+  fclose(stream);
+  digestExceptLoaded = (ref == DIGEST_REF_OUTCOME || ref == DIGEST_REF_TAKEN);
+  digestRef = ref;
+  digest_next_exception();
+}
+
+void init_digest()
+{
+  digestWord = 0;
+  digestOutcomes = 0;
+  digestCount = 0;
+  digestHash = 0;
+  digestFirstDiff = -1;
+  digestGoldenDiff = -1;
+  digestExceptLoaded = 0;
+  digestExceptPos = 0;
+  digestExceptIndex[0] = digestExceptIndex[1] = 0;
+  if (digestMode == DIGEST_CHECK && digestTrace != NULL)
+  {
+    digest_load_exceptions();
+  }
+  digestBitsStream = NULL;
+  if (digestBits != NULL)
+  {
+    digestBitsStream = fopen(digestBits, "rb");
+    digestBitsReading = (digestBitsStream != NULL);
+    if (!digestBitsReading)
+    {
+      digestBitsStream = fopen(digestBits, "wb");
+    }
+  }
+}
+
+// Index of the first of 'bits' valid predictions in 'word' that differs
+// from 'reference', or -1
+//
+static int64_t digest_first_diff(uint64_t word, uint64_t reference, int bits, uint64_t firstIndex)
+{
+  uint64_t diff = (word ^ reference) & (bits == 64 ? ~0ULL : ((1ULL << bits) - 1));
+  if (diff == 0)
+    return -1;
+  // the oldest prediction sits in the highest valid bit
+  return firstIndex + (bits - 1 - (63 - __builtin_clzll(diff)));
+}
+
+// Compare one word of 'bits' valid predictions with the reference bitstream
+//
+static void digest_compare_bits(uint64_t word, int bits, uint64_t firstIndex)
+{
+  uint64_t reference;
+  if (digestFirstDiff >= 0 || fread(&reference, sizeof(reference), 1, digestBitsStream) != 1)
+  {
+    return;
+  }
+  digestFirstDiff = digest_first_diff(word, reference, bits, firstIndex);
+}
+
+// Append the branches of one word that differ from each reference
+//
+static void digest_record_exceptions(uint64_t word, uint64_t outcomes, int bits, uint64_t firstIndex)
+{
+  uint64_t reference[2] = {outcomes, ~0ULL};
+  for (int r = 0; r < 2; r++)
+  {
+    uint64_t diff = (word ^ reference[r]) & (bits == 64 ? ~0ULL : ((1ULL << bits) - 1));
+    while (diff)
+    {
+      int bit = 63 - __builtin_clzll(diff);
+      diff ^= 1ULL << bit;
+      uint64_t index = firstIndex + (bits - 1 - bit);
+      uint64_t gap = index - digestExceptIndex[r];
+      digestExceptIndex[r] = index + 1;
+      do
+      {
+        digestExceptions[r].push_back((gap & 127) | (gap >= 128 ? 128 : 0));
+        gap >>= 7;
+      } while (gap);
+    }
+  }
+}
+
+// Rebuild the golden predictions of one word from the exception list
+// and compare them with ours
+//
+static void digest_compare_exceptions(uint64_t word, uint64_t outcomes, int bits, uint64_t firstIndex)
+{
+  uint64_t reference = (digestRef == DIGEST_REF_OUTCOME) ? outcomes : ~0ULL;
+  while (digestNextException < firstIndex + bits)
+  {
+    reference ^= 1ULL << (bits - 1 - (digestNextException - firstIndex));
+    digest_next_exception();
+  }
+  digestGoldenDiff = digest_first_diff(word, reference, bits, firstIndex);
+}
+
+// Keep the exception list of one word of 'bits' predictions
+//
+static void digest_exceptions(int bits)
+{
+  if (digestMode == DIGEST_UPDATE)
+    digest_record_exceptions(digestWord, digestOutcomes, bits, digestCount - bits);
+  else if (digestExceptLoaded && digestGoldenDiff < 0)
+    digest_compare_exceptions(digestWord, digestOutcomes, bits, digestCount - bits);
+}
+
+void digest_fold_word()
+{
+  digestHash = digest_mix(digestHash, digestWord);
+  digest_exceptions(64);
+  if (digestBitsStream != NULL)
+  {
+    if (digestBitsReading)
+      digest_compare_bits(digestWord, 64, digestCount - 64);
+    else
+      fwrite(&digestWord, sizeof(digestWord), 1, digestBitsStream);
+  }
+  if ((digestCount & ((1u << DIGEST_CHECKPOINT_BITS) - 1)) == 0)
+  {
+    digestCheckpoints.push_back(digestHash);
+  }
+  digestWord = 0;
+  digestOutcomes = 0;
+}
+
+// Read every line of the golden file into 'lines'
+//
+static void digest_read_golden(std::vector<std::string> &lines)
+{
+  FILE *golden = fopen(digestFile, "r");
+  if (golden == NULL)
+    return;
+  char *line = NULL;
+  size_t len = 0;
+  while (getline(&line, &len, golden) != -1)
+  {
+    line[strcspn(line, "\n")] = 0;
+    if (line[0] != 0)
+      lines.push_back(line);
+  }
+  free(line);
+  fclose(golden);
+}
+
+int digest_finish(uint64_t num_branches, uint64_t mispredictions)
+{
+  // fold the last partial word together with the branch count
+  int tail = digestCount & 63;
+  if (tail != 0)
+    digest_exceptions(tail);
+  if (digestBitsStream != NULL && tail != 0)
+  {
+    if (digestBitsReading)
+      digest_compare_bits(digestWord, tail, digestCount - tail);
+    else
+      fwrite(&digestWord, sizeof(digestWord), 1, digestBitsStream);
+  }
+  if (digestBitsStream != NULL)
+    fclose(digestBitsStream);
+  uint64_t finalHash = digest_mix(digest_mix(digestHash, digestWord), digestCount);
+
+  if (digestTrace == NULL)
+  {
+    fprintf(stderr, "Digest: no trace name, use --digest:<trace> when reading stdin\n");
+    return 1;
+  }
+  const char *predictor = bpName[bpType];
+  char key[256];
+  snprintf(key, sizeof(key), "%s %s ", digestTrace, predictor);
+
+  std::vector<std::string> lines;
+  digest_read_golden(lines);
+  int found = -1;
+  for (size_t i = 0; i < lines.size(); i++)
+  {
+    if (!strncmp(lines[i].c_str(), key, strlen(key)))
+      found = i;
+  }
+
+  if (digestMode == DIGEST_UPDATE)
+  {
+    std::string entry = key;
+    char field[64];
+    snprintf(field, sizeof(field), "%llu %llu %016llx %zu", (unsigned long long)num_branches, (unsigned long long)mispredictions,
+             (unsigned long long)finalHash, digestCheckpoints.size());
+    entry += field;
+    for (size_t c = 0; c < digestCheckpoints.size(); c++)
+    {
+      snprintf(field, sizeof(field), " %016llx", (unsigned long long)digestCheckpoints[c]);
+      entry += field;
+    }
+    if (found >= 0)
+      lines[found] = entry;
+    else
+      lines.push_back(entry);
+
+    FILE *golden = fopen(digestFile, "w");
+    if (golden == NULL)
+    {
+      fprintf(stderr, "Digest: cannot write %s\n", digestFile);
+      return 1;
+    }
+    for (size_t i = 0; i < lines.size(); i++)
+      fprintf(golden, "%s\n", lines[i].c_str());
+    fclose(golden);
+
+    // store the exception list against the reference with fewer bytes
+    std::string path = digest_exception_path();
+    mkdir(path.substr(0, path.rfind('/')).c_str(), 0777);
+    int ref = (digestExceptions[DIGEST_REF_TAKEN].size() < digestExceptions[DIGEST_REF_OUTCOME].size())
+                  ? DIGEST_REF_TAKEN
+                  : DIGEST_REF_OUTCOME;
+    FILE *stream = fopen(path.c_str(), "wb");
+    if (stream == NULL)
+    {
+      fprintf(stderr, "Digest: cannot write %s\n", path.c_str());
+      return 1;
+    }
+    fputc(ref, stream);
+    fwrite(digestExceptions[ref].data(), 1, digestExceptions[ref].size(), stream);
+    fclose(stream);
+    printf("Digest: updated %s/%s in %s\n", digestTrace, predictor, digestFile);
+    return 0;
+  }
+
+  if (found < 0)
+  {
+    printf("Digest: no golden entry for %s/%s in %s\n", digestTrace, predictor, digestFile);
+    return 1;
+  }
+
+  unsigned long long goldBranches, goldIncorrect;
+  unsigned long long goldHash;
+  int offset = 0;
+  const char *entry = lines[found].c_str() + strlen(key);
+  sscanf(entry, "%llu %llu %llx %*u%n", &goldBranches, &goldIncorrect, &goldHash, &offset);
+  if (goldBranches == num_branches && goldIncorrect == mispredictions && goldHash == finalHash)
+  {
+    printf("Digest: OK %s/%s\n", digestTrace, predictor);
+    return 0;
+  }
+
+  printf("Digest: MISMATCH %s/%s (branches %llu vs %llu, incorrect %llu vs golden %llu)\n",
+         digestTrace, predictor, (unsigned long long)num_branches, goldBranches,
+         (unsigned long long)mispredictions, goldIncorrect);
+
+  // first checkpoint window whose hash differs
+  const char *p = entry + offset;
+  uint32_t window = 0;
+  unsigned long long checkpoint;
+  int used;
+  while (window < digestCheckpoints.size() && sscanf(p, " %llx%n", &checkpoint, &used) == 1 &&
+         checkpoint == digestCheckpoints[window])
+  {
+    p += used;
+    window++;
+  }
+  uint64_t first = (uint64_t)window << DIGEST_CHECKPOINT_BITS;
+  uint64_t last = (first + (1u << DIGEST_CHECKPOINT_BITS) < num_branches) ? first + (1u << DIGEST_CHECKPOINT_BITS) : num_branches;
+  printf("Digest: first divergent branch index in [%llu, %llu)\n", (unsigned long long)first, (unsigned long long)last);
+  if (digestGoldenDiff >= 0)
+  {
+    printf("Digest: first divergent branch index %lld\n", (long long)digestGoldenDiff);
+  }
+  else if (!digestExceptLoaded)
+  {
+    printf("Digest: no exception list %s, rerun --digest-update for the exact index\n", digest_exception_path().c_str());
+  }
+  if (digestFirstDiff >= 0)
+  {
+    printf("Digest: first divergent branch index %lld (from %s)\n", (long long)digestFirstDiff, digestBits);
+  }
+  return 1;
+}
@@ -0,0 +1,68 @@
+//========================================================//
+//  digest.h                                              //
+//  Header file for the golden prediction-stream digests  //
+//                                                        //
+//  Hashes the stream of predictions made on conditional  //
+//  branches and checks it against a checked-in golden    //
+//  file, so optimizations of the predictor code can be   //
+//  shown not to change a single prediction               //
+//========================================================//
+
+#ifndef DIGEST_H
+#define DIGEST_H
+
+#include <stdint.h>
+
+//------------------------------------//
+//       Digest Configuration         //
+//------------------------------------//
+#define DIGEST_OFF 0
+#define DIGEST_CHECK 1  // compare against the golden file
+#define DIGEST_UPDATE 2 // write this run into the golden file
+
+// Branches between two checkpoint hashes in the golden file
+#define DIGEST_CHECKPOINT_BITS 16
+
+// Reference the golden exception list is stored against: the branch
+// outcome (the exceptions are the mispredictions) or always taken
+#define DIGEST_REF_OUTCOME 0
+#define DIGEST_REF_TAKEN 1
+
+extern int digestMode;
+extern const char *digestFile;  // golden file
+extern const char *digestTrace; // trace name the entry is stored under
+extern const char *digestBits;  // optional raw prediction bitstream file
+
+//------------------------------------//
+//     Digest Function Prototypes     //
+//------------------------------------//
+
+void init_digest();
+
+// Compare with (or store into) the golden file and print the result.
+// Returns 0 when the digest matches or was updated
+//
+int digest_finish(uint64_t num_branches, uint64_t mispredictions);
+
+//------------------------------------//
+//      Inline Digest Internals       //
+//------------------------------------//
+extern uint64_t digestWord;     // predictions not yet folded into the hash
+extern uint64_t digestOutcomes; // outcomes of the same branches
+extern uint64_t digestCount;    // predictions seen so far
+void digest_fold_word();
+
+// Fold the prediction for the next conditional branch into the digest.
+// Only every 64th call does any hashing
+//
+static inline void digest_update(uint32_t prediction, uint32_t outcome)
+{
+  digestWord = (digestWord << 1) | (prediction & 1);
+  digestOutcomes = (digestOutcomes << 1) | (outcome & 1);
+  if ((++digestCount & 63) == 0)
+  {
+    digest_fold_word();
+  }
+}
+
+#endif
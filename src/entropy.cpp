@@ -0,0 +1,247 @@
+//========================================================//
+//  entropy.cpp                                           //
+//  Source file for the per-branch predictability pass    //
+//                                                        //
+//  Histories are stored bit-reversed (most recent        //
+//  outcome in the top bit), so one sort of a branch's    //
+//  occurrences groups them by every history length k at  //
+//  once: the k-bit groups are runs of equal top k bits   //
+//========================================================//
+#include <stdio.h>
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "predictor.h"
+#include "entropy.h"
+#include "hashmap.h"
+
+//------------------------------------//
+//      Analyzer Configuration        //
+//------------------------------------//
+int entropyMode = 0;
+const char *entropyFile = "entropy.tsv";
+
+// History lengths the conditional entropy is computed for
+#define ENTROPY_HIST_BITS 16
+#define ENTROPY_NUM_K 6
+const int entropyK[ENTROPY_NUM_K] = {1, 2, 4, 8, 12, 16};
+
+//------------------------------------//
+//      Analyzer Data Structures      //
+//------------------------------------//
+
+// One row of the output table
+typedef struct
+{
+  uint32_t pc;
+  uint32_t count;          // dynamic executions
+  uint32_t taken;          // of which taken
+  uint32_t transitions;    // outcome differs from the previous execution
+  float globalH[ENTROPY_NUM_K]; // H(outcome | last k global outcomes)
+  float localH[ENTROPY_NUM_K];  // H(outcome | last k outcomes of this branch)
+} entropyRow;
+
+FlatMap<uint32_t> *entropyIds; // pc -> static branch id
+std::vector<uint32_t> entropyPC; // static branch id -> pc
+
+// Recorded dynamic stream, one element per conditional branch
+std::vector<uint32_t> recId;
+std::vector<uint16_t> recGhist; // bit-reversed global history before the branch
+std::vector<uint8_t> recOutcome;
+uint16_t entropy_ghistory;      // bit-reversed: bit 15 is the latest outcome
+
+//------------------------------------//
+//        Analyzer Functions          //
+//------------------------------------//
+
+void init_entropy()
+{
+  entropyIds = new FlatMap<uint32_t>(1 << 12);
+  entropy_ghistory = 0;
+  recId.reserve(1 << 24);
+  recGhist.reserve(1 << 24);
+  recOutcome.reserve(1 << 24);
+}
+
+void entropy_record(uint32_t pc, uint32_t outcome)
+{
+  uint32_t &id = entropyIds->find_or_insert(pc, (uint32_t)entropyPC.size());
+  if (id == entropyPC.size())
+  {
+    entropyPC.push_back(pc);
+  }
+  recId.push_back(id);
+  recGhist.push_back(entropy_ghistory);
+  recOutcome.push_back(outcome);
+  entropy_ghistory = (entropy_ghistory >> 1) | (outcome << (ENTROPY_HIST_BITS - 1));
+}
+
+static double binary_entropy(uint32_t taken, uint32_t n)
+{
+  if (taken == 0 || taken == n)
+    return 0;
+  double p = (double)taken / n;
+  return -p * log2(p) - (1 - p) * log2(1 - p);
+}
+
+// Fill 'H' with the conditional entropy for every k from the keys
+// ((reversed history << 1) | outcome) of one branch; sorts 'keys'
+//
+static void conditional_entropy(std::vector<uint32_t> &keys, float *H)
+{
+  std::sort(keys.begin(), keys.end());
+  uint32_t n = keys.size();
+  for (int k = 0; k < ENTROPY_NUM_K; k++)
+  {
+    int shift = ENTROPY_HIST_BITS + 1 - entropyK[k];
+    double sum = 0;
+    uint32_t i = 0;
+    while (i < n)
+    {
+      uint32_t group = keys[i] >> shift;
+      uint32_t start = i, taken = 0;
+      for (; i < n && (keys[i] >> shift) == group; i++)
+      {
+        taken += keys[i] & 1;
+      }
+      sum += (i - start) * binary_entropy(taken, i - start);
+    }
+    H[k] = (float)(sum / n);
+  }
+}
+
+// Analyze the static branch 'id', whose executions are
+// order[begin..end) in trace order
+//
+static void entropy_analyze(uint32_t id, const uint32_t *order, uint32_t begin, uint32_t end, entropyRow *row)
+{
+  std::vector<uint32_t> gkeys, lkeys;
+  gkeys.reserve(end - begin);
+  lkeys.reserve(end - begin);
+
+  uint16_t lhistory = 0;
+  int previous = -1;
+  row->pc = entropyPC[id];
+  row->count = end - begin;
+  row->taken = 0;
+  row->transitions = 0;
+  for (uint32_t i = begin; i < end; i++)
+  {
+    uint32_t r = order[i];
+    uint32_t outcome = recOutcome[r];
+    gkeys.push_back(((uint32_t)recGhist[r] << 1) | outcome);
+    lkeys.push_back(((uint32_t)lhistory << 1) | outcome);
+    row->taken += outcome;
+    row->transitions += (previous >= 0 && (uint32_t)previous != outcome);
+    previous = outcome;
+    lhistory = (lhistory >> 1) | (outcome << (ENTROPY_HIST_BITS - 1));
+  }
+  conditional_entropy(gkeys, row->globalH);
+  conditional_entropy(lkeys, row->localH);
+}
+
+void entropy_report()
+{
+  uint32_t numPCs = entropyPC.size();
+  uint32_t numRecs = recId.size();
+
+  // counting sort of the dynamic stream by static branch, keeping trace order
+  std::vector<uint32_t> offset(numPCs + 1, 0);
+  for (uint32_t r = 0; r < numRecs; r++)
+    offset[recId[r] + 1]++;
+  for (uint32_t id = 0; id < numPCs; id++)
+    offset[id + 1] += offset[id];
+  std::vector<uint32_t> order(numRecs);
+  std::vector<uint32_t> fill(offset.begin(), offset.end() - 1);
+  for (uint32_t r = 0; r < numRecs; r++)
+    order[fill[recId[r]]++] = r;
+
+  // hand out the hottest branches first so the threads finish together
+  std::vector<uint32_t> work(numPCs);
+  for (uint32_t id = 0; id < numPCs; id++)
+    work[id] = id;
+  std::sort(work.begin(), work.end(), [&](uint32_t a, uint32_t b)
+            { return offset[a + 1] - offset[a] > offset[b + 1] - offset[b]; });
+
+  std::vector<entropyRow> rows(numPCs);
+  std::atomic<uint32_t> next(0);
+  auto worker = [&]()
+  {
+    for (uint32_t w = next++; w < numPCs; w = next++)
+    {
+      uint32_t id = work[w];
+      entropy_analyze(id, order.data(), offset[id], offset[id + 1], &rows[w]);
+    }
+  };
+  unsigned numThreads = std::max(1u, std::thread::hardware_concurrency());
+  std::vector<std::thread> threads;
+  for (unsigned t = 1; t < numThreads; t++)
+    threads.emplace_back(worker);
+  worker();
+  for (auto &t : threads)
+    t.join();
+
+  // rows are already sorted by dynamic count, hottest first
+  FILE *out = fopen(entropyFile, "w");
+  if (out == NULL)
+  {
+    fprintf(stderr, "Cannot write %s\n", entropyFile);
+  }
+  else
+  {
+    fprintf(out, "pc\tcount\ttaken_rate\tbias\ttransition_rate");
+    for (int k = 0; k < ENTROPY_NUM_K; k++)
+      fprintf(out, "\tHg%d", entropyK[k]);
+    for (int k = 0; k < ENTROPY_NUM_K; k++)
+      fprintf(out, "\tHl%d", entropyK[k]);
+    fprintf(out, "\n");
+  }
+
+  double weighted[2 * ENTROPY_NUM_K + 2] = {0};
+  for (uint32_t w = 0; w < numPCs; w++)
+  {
+    entropyRow *row = &rows[w];
+    double takenRate = (double)row->taken / row->count;
+    double bias = takenRate > 0.5 ? takenRate : 1 - takenRate;
+    double transitionRate = row->count > 1 ? (double)row->transitions / (row->count - 1) : 0;
+    weighted[0] += bias * row->count;
+    weighted[1] += transitionRate * row->count;
+    for (int k = 0; k < ENTROPY_NUM_K; k++)
+    {
+      weighted[2 + k] += row->globalH[k] * row->count;
+      weighted[2 + ENTROPY_NUM_K + k] += row->localH[k] * row->count;
+    }
+    if (out == NULL)
+      continue;
+    fprintf(out, "0x%x\t%u\t%.4f\t%.4f\t%.4f", row->pc, row->count, takenRate, bias, transitionRate);
+    for (int k = 0; k < ENTROPY_NUM_K; k++)
+      fprintf(out, "\t%.4f", row->globalH[k]);
+    for (int k = 0; k < ENTROPY_NUM_K; k++)
+      fprintf(out, "\t%.4f", row->localH[k]);
+    fprintf(out, "\n");
+  }
+  if (out != NULL)
+    fclose(out);
+
+  printf("\nPredictability (%u static branches, %u threads, table in %s)\n", numPCs, numThreads, entropyFile);
+  printf("Weighted bias:            %7.4f\n", numRecs ? weighted[0] / numRecs : 0);
+  printf("Weighted transition rate: %7.4f\n", numRecs ? weighted[1] / numRecs : 0);
+  printf("%-8s %10s %10s\n", "k", "H|global", "H|local");
+  for (int k = 0; k < ENTROPY_NUM_K; k++)
+  {
+    printf("%-8d %10.4f %10.4f\n", entropyK[k],
+           numRecs ? weighted[2 + k] / numRecs : 0,
+           numRecs ? weighted[2 + ENTROPY_NUM_K + k] / numRecs : 0);
+  }
+}
+
+void cleanup_entropy()
+{
+  delete entropyIds;
+  recId.clear();
+  recGhist.clear();
+  recOutcome.clear();
+}
@@ -0,0 +1,39 @@
+//========================================================//
+//  entropy.h                                             //
+//  Header file for the per-branch predictability pass    //
+//                                                        //
+//  Records every conditional branch of the trace and,    //
+//  at the end of the run, computes per static branch its //
+//  bias, transition rate and the conditional entropy of  //
+//  its outcome given the last k global / local outcomes  //
+//========================================================//
+
+#ifndef ENTROPY_H
+#define ENTROPY_H
+
+#include <stdint.h>
+
+//------------------------------------//
+//      Analyzer Configuration        //
+//------------------------------------//
+extern int entropyMode;          // Non-zero when --entropy was given
+extern const char *entropyFile;  // TSV output, one row per static branch
+
+//------------------------------------//
+//    Analyzer Function Prototypes    //
+//------------------------------------//
+
+void init_entropy();
+
+// Record the conditional branch at 'pc' for the offline pass
+//
+void entropy_record(uint32_t pc, uint32_t outcome);
+
+// Run the pass over all recorded branches (in parallel across PCs),
+// write the table to entropyFile and print a summary on stdout
+//
+void entropy_report();
+
+void cleanup_entropy();
+
+#endif
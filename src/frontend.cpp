@@ -0,0 +1,152 @@
+//========================================================//
+//  frontend.cpp                                          //
+//  Source file for the front-end timing model            //
+//                                                        //
+//  A fetch run spans from a taken branch's target to the //
+//  next taken branch; the bytes it takes from each block //
+//  are counted in O(1) per run, in a histogram           //
+//========================================================//
+#include <stdio.h>
+#include <string.h>
+#include "frontend.h"
+#include "btb.h"
+
+//------------------------------------//
+//     Front-end Configuration        //
+//------------------------------------//
+int frontendMode = 0;
+int frontendWidth = 4;
+int frontendBlock = 32;
+int penaltyDirection = 14;
+int penaltyTarget = 14;
+int penaltyBtb = 3;
+
+//------------------------------------//
+//     Front-end Data Structures      //
+//------------------------------------//
+
+int frontendBlockBits;
+uint32_t frontendRunStart; // first byte of the current fetch run
+int frontendRunValid;      // 0 until the first taken branch
+
+uint64_t frontendChunks[FRONTEND_MAX_BLOCK + 1]; // fetches of n bytes from one block, by n
+uint64_t frontendBytes;
+uint64_t frontendGaps;
+uint64_t directionEvents, targetEvents, btbEvents;
+
+//------------------------------------//
+//       Front-end Functions          //
+//------------------------------------//
+
+void init_frontend()
+{
+  frontendBlockBits = 0;
+  while ((1 << frontendBlockBits) < frontendBlock)
+    frontendBlockBits++;
+  frontendRunValid = 0;
+  memset(frontendChunks, 0, sizeof(frontendChunks));
+  frontendBytes = frontendGaps = 0;
+  directionEvents = targetEvents = btbEvents = 0;
+}
+
+// the run from 'start' to the taken branch at 'end': its first and
+// last blocks are partial, the ones between full
+static void fetch_run(uint32_t start, uint32_t end)
+{
+  uint32_t first = start >> frontendBlockBits;
+  uint32_t last = end >> frontendBlockBits;
+  uint32_t mask = frontendBlock - 1;
+  frontendBytes += end - start + 1;
+  if (first == last)
+  {
+    frontendChunks[end - start + 1]++;
+    return;
+  }
+  frontendChunks[frontendBlock - (start & mask)]++;
+  frontendChunks[(end & mask) + 1]++;
+  frontendChunks[frontendBlock] += last - first - 1;
+}
+
+void frontend_update(const branchRecord &b, int wrong, int btbFound, int targetWrong)
+{
+  int taken = b.outcome || !b.condition;
+  if (taken)
+  {
+    if (frontendRunValid && b.pc >= frontendRunStart && b.pc - frontendRunStart < FRONTEND_MAX_RUN)
+    {
+      fetch_run(frontendRunStart, b.pc);
+    }
+    else
+    {
+      frontendGaps += frontendRunValid;
+    }
+    frontendRunStart = b.target;
+    frontendRunValid = 1;
+  }
+  // (fetch carries on through a not-taken branch)
+
+  // one redirect per branch, the one found last in the pipeline
+  if (b.condition && wrong)
+  {
+    directionEvents++; // execute redirects, whatever the BTB held
+  }
+  else if (!b.condition && !b.direct && !b.ret)
+  {
+    targetEvents += targetWrong >= 0 ? targetWrong : (btbFound & (BTB_MISSED | BTB_WRONG)) != 0;
+  }
+  else if (b.ret && (btbFound & RAS_WRONG))
+  {
+    targetEvents++;
+  }
+  else if (btbFound & BTB_MISSED)
+  {
+    btbEvents++; // decode finds the branch and its target (or the return stack's)
+  }
+}
+
+void frontend_report(uint64_t instructions)
+{
+  int estimated = instructions == 0;
+  if (estimated)
+    instructions = frontendBytes / FRONTEND_INSN_BYTES;
+  // a fetch of n bytes from one block carries n * density instructions
+  double density = frontendBytes ? (double)instructions / frontendBytes : 0.0;
+  uint64_t frontendCycles = 0;
+  for (int n = 1; n <= frontendBlock; n++)
+  {
+    double insns = n * density;
+    uint64_t cycles = (uint64_t)(insns / frontendWidth);
+    cycles += cycles * frontendWidth < insns || cycles == 0; // ceil, and at least one cycle
+    frontendCycles += frontendChunks[n] * cycles;
+  }
+  uint64_t directionCycles = directionEvents * penaltyDirection;
+  uint64_t targetCycles = targetEvents * penaltyTarget;
+  uint64_t btbCycles = btbEvents * penaltyBtb;
+  uint64_t overrideEvents = OverrideType >= 0 ? OverrideCount : 0; // fetch refilled behind the slow prediction
+  uint64_t overrideCycles = overrideEvents * OverrideLatency;
+  uint64_t lost = directionCycles + targetCycles + btbCycles + overrideCycles;
+  uint64_t cycles = frontendCycles + lost;
+
+  printf("\nFront end: %d instructions/cycle from %d-byte blocks\n", frontendWidth, frontendBlock);
+  printf("  fetch cycles:    %10llu  (%llu bytes, %.2f bytes per instruction, %llu gaps)\n",
+         (unsigned long long)frontendCycles, (unsigned long long)frontendBytes, density ? 1 / density : 0.0,
+         (unsigned long long)frontendGaps);
+  printf("  %-14s %10s %8s %12s\n", "redirects", "events", "penalty", "cycles lost");
+  printf("  %-14s %10llu %8d %12llu\n", "direction", (unsigned long long)directionEvents, penaltyDirection,
+         (unsigned long long)directionCycles);
+  printf("  %-14s %10llu %8d %12llu\n", "target", (unsigned long long)targetEvents, penaltyTarget,
+         (unsigned long long)targetCycles);
+  printf("  %-14s %10llu %8d %12llu\n", "BTB miss", (unsigned long long)btbEvents, penaltyBtb,
+         (unsigned long long)btbCycles);
+  if (OverrideType >= 0)
+  {
+    printf("  %-14s %10llu %8d %12llu\n", "override", (unsigned long long)overrideEvents, OverrideLatency,
+           (unsigned long long)overrideCycles);
+  }
+  printf("  cycles lost:     %10llu  (%.2f%% of %llu)\n", (unsigned long long)lost,
+         cycles ? 100.0 * lost / cycles : 0.0, (unsigned long long)cycles);
+  printf("  instructions:    %10llu%s\n", (unsigned long long)instructions,
+         estimated ? "  (estimated, no trace summary)" : "");
+  printf("  IPC:             %10.3f  (%.3f with no redirects)\n", cycles ? (double)instructions / cycles : 0.0,
+         frontendCycles ? (double)instructions / frontendCycles : 0.0);
+}
@@ -0,0 +1,65 @@
+//========================================================//
+//  frontend.h                                            //
+//  Header file for the front-end timing model            //
+//                                                        //
+//  Turns the trace's fetch runs and the predictors'      //
+//  misses into fetch cycles, lost cycles and IPC         //
+//========================================================//
+
+#ifndef FRONTEND_H
+#define FRONTEND_H
+
+#include <stdint.h>
+#include "predictor.h"
+
+//------------------------------------//
+//     Front-end Configuration        //
+//------------------------------------//
+
+// Fetch delivers up to 'width' instructions per cycle from one
+// aligned 'block'-byte fetch block (a power of two), and a taken
+// branch ends the cycle. The trace has no instruction lengths: the
+// bytes fetched from each block are counted, and turned into
+// instructions with the trace's density (the summary's instruction
+// count over the bytes the runs cover) when the report is printed.
+#define FRONTEND_MAX_WIDTH 64
+#define FRONTEND_MAX_BLOCK 256
+
+// A run longer than this from a taken branch's target to the next
+// taken branch (or one running backwards) means the trace skipped
+// code, e.g. a call into untraced code: it is counted as a gap and
+// its instructions are spread over the rest through the density
+#define FRONTEND_MAX_RUN 4096
+
+// Instruction length assumed when the trace has no summary
+#define FRONTEND_INSN_BYTES 4
+
+extern int frontendMode;  // Non-zero when --frontend was given
+extern int frontendWidth; // instructions fetched per cycle
+extern int frontendBlock; // fetch block bytes
+
+// Redirect penalties, in cycles
+extern int penaltyDirection; // conditional direction mispredicted, found at execute
+extern int penaltyTarget;    // indirect or return target mispredicted, found at execute
+extern int penaltyBtb;       // direct taken branch missing from the BTB, found at decode
+
+//------------------------------------//
+//    Front-end Function Prototypes   //
+//------------------------------------//
+
+void init_frontend();
+
+// Account for record 'b': 'wrong' is 1 if its direction was
+// mispredicted, 'btbFound' what btb_update returned for it and
+// 'targetWrong' whether the ITTAGE missed its target (-1 when
+// --ittage is off, so indirect targets come from the BTB)
+//
+void frontend_update(const branchRecord &b, int wrong, int btbFound, int targetWrong);
+
+// Print fetch and lost cycles and the IPC over 'instructions'
+// (0 = unknown: estimated from the bytes fetched); an --override
+// pair's bubbles count among the lost cycles
+//
+void frontend_report(uint64_t instructions);
+
+#endif
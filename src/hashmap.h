@@ -0,0 +1,131 @@
+//========================================================//
+//  hashmap.h                                             //
+//  Open-addressing hash map with pooled value storage    //
+//                                                        //
+//  Used by the unbounded reference predictors, which     //
+//  need one entry per PC or per (PC, history) pair       //
+//========================================================//
+
+#ifndef HASHMAP_H
+#define HASHMAP_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Keys are 64-bit, linear probing over a power-of-two slot array.
+// Slots only hold the key and a 32-bit handle into a pool of values;
+// the pool grows in fixed chunks and is never moved, so a grow only
+// rehashes the (key, handle) pairs and references to values stay valid.
+//
+template <typename V>
+class FlatMap
+{
+public:
+  FlatMap(uint32_t initialSlots = 1 << 16)
+  {
+    slotBits = 0;
+    while ((1u << slotBits) < initialSlots)
+      slotBits++;
+    alloc_slots(slotBits);
+    chunks = NULL;
+    numChunks = 0;
+    count = 0;
+  }
+
+  ~FlatMap()
+  {
+    free(keys);
+    free(handles);
+    for (uint32_t c = 0; c < numChunks; c++)
+      free(chunks[c]);
+    free(chunks);
+  }
+
+  // Number of distinct keys inserted
+  uint32_t size() const { return count; }
+
+  // Return the value for 'key', inserting 'init' if the key is new
+  V &find_or_insert(uint64_t key, const V &init)
+  {
+    uint32_t mask = (1u << slotBits) - 1;
+    uint32_t slot = hash(key) & mask;
+    while (handles[slot] != EMPTY)
+    {
+      if (keys[slot] == key)
+        return pool(handles[slot]);
+      slot = (slot + 1) & mask;
+    }
+
+    // new key: take the next pooled node
+    if ((count >> CHUNK_BITS) == numChunks)
+    {
+      chunks = (V **)realloc(chunks, (numChunks + 1) * sizeof(V *));
+      chunks[numChunks++] = (V *)malloc(sizeof(V) << CHUNK_BITS);
+    }
+    uint32_t handle = count++;
+    pool(handle) = init;
+    keys[slot] = key;
+    handles[slot] = handle;
+
+    // keep the load factor under 1/2 so probe chains stay short
+    if (count * 2 > (1u << slotBits))
+      grow();
+    return pool(handle);
+  }
+
+private:
+  static const uint32_t EMPTY = 0xffffffff;
+  static const uint32_t CHUNK_BITS = 16; // 64K values per pool chunk
+
+  uint64_t *keys;
+  uint32_t *handles;
+  uint32_t slotBits;
+  V **chunks;
+  uint32_t numChunks;
+  uint32_t count;
+
+  static uint32_t hash(uint64_t key)
+  {
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdULL;
+    key ^= key >> 33;
+    return (uint32_t)key;
+  }
+
+  V &pool(uint32_t handle)
+  {
+    return chunks[handle >> CHUNK_BITS][handle & ((1u << CHUNK_BITS) - 1)];
+  }
+
+  void alloc_slots(uint32_t bits)
+  {
+    keys = (uint64_t *)malloc(sizeof(uint64_t) << bits);
+    handles = (uint32_t *)malloc(sizeof(uint32_t) << bits);
+    memset(handles, 0xff, sizeof(uint32_t) << bits);
+  }
+
+  void grow()
+  {
+    uint64_t *oldKeys = keys;
+    uint32_t *oldHandles = handles;
+    uint32_t oldSlots = 1u << slotBits;
+
+    alloc_slots(++slotBits);
+    uint32_t mask = (1u << slotBits) - 1;
+    for (uint32_t i = 0; i < oldSlots; i++)
+    {
+      if (oldHandles[i] == EMPTY)
+        continue;
+      uint32_t slot = hash(oldKeys[i]) & mask;
+      while (handles[slot] != EMPTY)
+        slot = (slot + 1) & mask;
+      keys[slot] = oldKeys[i];
+      handles[slot] = oldHandles[i];
+    }
+    free(oldKeys);
+    free(oldHandles);
+  }
+};
+
+#endif
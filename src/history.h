@@ -0,0 +1,132 @@
+//========================================================//
+//  history.h                                             //
+//  Long global history and folded history registers      //
+//                                                        //
+//  LongHistory keeps the last few thousand outcomes in a //
+//  circular bit buffer; FoldedHistory keeps an 'orig'    //
+//  bit window of it XOR-folded down to a table's index   //
+//  width, updated in O(1) per branch at any length       //
+//========================================================//
+
+#ifndef HISTORY_H
+#define HISTORY_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Bit i (i = 0 is the newest outcome) is read straight out of the
+// circular buffer, so any window of the history can be folded without
+// shifting the whole register. The newest 64 outcomes are also kept in
+// 'recent' for indexes that use a plain shift register.
+//
+class LongHistory
+{
+public:
+  uint64_t recent; // newest outcome in bit 0
+
+  LongHistory() : recent(0), words(NULL), head(0), mask(0) {}
+
+  // Allocate room for at least 'bits' outcomes, all not taken
+  void init(uint32_t bits)
+  {
+    uint32_t capacity = 64;
+    while (capacity < bits)
+      capacity <<= 1;
+    mask = capacity - 1;
+    words = (uint64_t *)calloc(capacity / 64, sizeof(uint64_t));
+    head = 0;
+    recent = 0;
+  }
+
+  void release()
+  {
+    free(words);
+    words = NULL;
+  }
+
+  uint32_t capacity() const { return mask + 1; }
+
+  // Outcome 'i' branches ago, i < capacity()
+  uint32_t bit(uint32_t i) const
+  {
+    uint32_t pos = (head - i) & mask;
+    return (words[pos >> 6] >> (pos & 63)) & 1;
+  }
+
+  void push(uint32_t outcome)
+  {
+    head = (head + 1) & mask;
+    uint64_t &word = words[head >> 6];
+    word = (word & ~(1ULL << (head & 63))) | ((uint64_t)outcome << (head & 63));
+    recent = (recent << 1) | outcome;
+  }
+
+  // Invert outcome 'i' branches ago in place (speculative history repair)
+  void flip(uint32_t i)
+  {
+    uint32_t pos = (head - i) & mask;
+    words[pos >> 6] ^= 1ULL << (pos & 63);
+    if (i < 64)
+      recent ^= 1ULL << i;
+  }
+
+private:
+  uint64_t *words;
+  uint32_t head; // position of the newest outcome
+  uint32_t mask;
+};
+
+// The newest 'orig' outcomes folded into 'width' bits: chunk k of the
+// window (bits k*width .. k*width+width-1) is XORed in at its own
+// alignment. After every push the new bit enters at position 0, the
+// bit falling out of the window (bit 'orig' of the history) is removed
+// at position orig % width, and the bit carried out of the top wraps
+// back to position 0.
+//
+class FoldedHistory
+{
+public:
+  uint32_t value;
+
+  FoldedHistory() : value(0), orig(0), width(1), outPoint(0) {}
+
+  void init(uint32_t origLength, uint32_t compLength)
+  {
+    value = 0;
+    orig = origLength;
+    width = compLength;
+    outPoint = origLength % compLength;
+  }
+
+  // Call after each LongHistory::push; 'h' must hold more than 'orig' outcomes
+  void update(const LongHistory &h)
+  {
+    update(h.bit(0), h.bit(orig));
+  }
+
+  // The same with the bits already read: 'in' = h.bit(0), 'out' = h.bit(orig),
+  // for several folds of one window sharing the reads
+  void update(uint32_t in, uint32_t out)
+  {
+    value = (value << 1) | in;
+    value ^= out << outPoint;
+    value ^= value >> width;
+    value &= (1u << width) - 1;
+  }
+
+  // Follow LongHistory::flip(i): the bit 'i' branches ago sits at
+  // position i % width while it is inside the window
+  void flip(uint32_t i)
+  {
+    if (i < orig)
+      value ^= 1u << (i % width);
+  }
+
+private:
+  uint32_t orig;
+  uint32_t width;
+  uint32_t outPoint;
+};
+
+#endif
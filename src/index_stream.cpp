@@ -0,0 +1,180 @@
+//========================================================//
+//  index_stream.cpp                                      //
+//  Source file for the block index pre-pass              //
+//                                                        //
+//  Each kernel has a scalar, an AVX2 (4 x 64-bit lanes)  //
+//  and an AVX-512 (8 lanes) version, picked by isa.h     //
+//========================================================//
+#include <immintrin.h>
+#include "index_stream.h"
+#include "isa.h"
+
+const char *block_index_isa()
+{
+  return isaName[current_isa()];
+}
+
+uint64_t block_pack_outcomes(const uint8_t *outcome, int n)
+{
+  uint64_t packed = 0;
+  for (int i = 0; i < n; i++)
+  {
+    packed |= (uint64_t)(outcome[i] & 1) << (63 - i);
+  }
+  return packed;
+}
+
+//------------------------------------//
+//           Scalar Kernels           //
+//------------------------------------//
+
+static inline uint64_t history_before(uint64_t h, uint64_t packed, int i)
+{
+  return i == 0 ? h : (h << i) | (packed >> (64 - i));
+}
+
+static void xor_index_scalar(uint64_t h, uint64_t packed, const uint32_t *pc, int n, uint32_t mask, uint32_t *index)
+{
+  for (int i = 0; i < n; i++)
+  {
+    index[i] = (pc[i] ^ (uint32_t)history_before(h, packed, i)) & mask;
+  }
+}
+
+static void hist_index_scalar(uint64_t h, uint64_t packed, int n, uint32_t mask, uint32_t *index)
+{
+  for (int i = 0; i < n; i++)
+  {
+    index[i] = (uint32_t)history_before(h, packed, i) & mask;
+  }
+}
+
+//------------------------------------//
+//            AVX2 Kernels            //
+//------------------------------------//
+
+// Histories before branches i..i+3; a variable shift by 64 or more gives 0,
+// so lane i = 0 needs no special case
+__attribute__((target("avx2"))) static inline __m256i history_avx2(__m256i h, __m256i packed, int i)
+{
+  __m256i lane = _mm256_add_epi64(_mm256_set1_epi64x(i), _mm256_setr_epi64x(0, 1, 2, 3));
+  __m256i right = _mm256_sub_epi64(_mm256_set1_epi64x(64), lane);
+  return _mm256_or_si256(_mm256_sllv_epi64(h, lane), _mm256_srlv_epi64(packed, right));
+}
+
+// Low halves of the four 64-bit lanes
+__attribute__((target("avx2"))) static inline __m128i narrow_avx2(__m256i v)
+{
+  return _mm256_castsi256_si128(_mm256_permutevar8x32_epi32(v, _mm256_setr_epi32(0, 2, 4, 6, 0, 0, 0, 0)));
+}
+
+__attribute__((target("avx2"))) static void xor_index_avx2(uint64_t h, uint64_t packed, const uint32_t *pc, int n, uint32_t mask, uint32_t *index)
+{
+  __m256i hv = _mm256_set1_epi64x(h);
+  __m256i pv = _mm256_set1_epi64x(packed);
+  __m256i mv = _mm256_set1_epi64x(mask);
+  int i = 0;
+  for (; i + 4 <= n; i += 4)
+  {
+    __m256i pcs = _mm256_cvtepu32_epi64(_mm_loadu_si128((const __m128i *)(pc + i)));
+    __m256i idx = _mm256_and_si256(_mm256_xor_si256(pcs, history_avx2(hv, pv, i)), mv);
+    _mm_storeu_si128((__m128i *)(index + i), narrow_avx2(idx));
+  }
+  for (; i < n; i++)
+  {
+    index[i] = (pc[i] ^ (uint32_t)history_before(h, packed, i)) & mask;
+  }
+}
+
+__attribute__((target("avx2"))) static void hist_index_avx2(uint64_t h, uint64_t packed, int n, uint32_t mask, uint32_t *index)
+{
+  __m256i hv = _mm256_set1_epi64x(h);
+  __m256i pv = _mm256_set1_epi64x(packed);
+  __m256i mv = _mm256_set1_epi64x(mask);
+  int i = 0;
+  for (; i + 4 <= n; i += 4)
+  {
+    __m256i idx = _mm256_and_si256(history_avx2(hv, pv, i), mv);
+    _mm_storeu_si128((__m128i *)(index + i), narrow_avx2(idx));
+  }
+  for (; i < n; i++)
+  {
+    index[i] = (uint32_t)history_before(h, packed, i) & mask;
+  }
+}
+
+//------------------------------------//
+//           AVX-512 Kernels          //
+//------------------------------------//
+
+__attribute__((target("avx512f"))) static inline __m512i history_avx512(__m512i h, __m512i packed, int i)
+{
+  __m512i lane = _mm512_add_epi64(_mm512_set1_epi64(i), _mm512_setr_epi64(0, 1, 2, 3, 4, 5, 6, 7));
+  __m512i right = _mm512_sub_epi64(_mm512_set1_epi64(64), lane);
+  return _mm512_or_si512(_mm512_sllv_epi64(h, lane), _mm512_srlv_epi64(packed, right));
+}
+
+__attribute__((target("avx512f"))) static void xor_index_avx512(uint64_t h, uint64_t packed, const uint32_t *pc, int n, uint32_t mask, uint32_t *index)
+{
+  __m512i hv = _mm512_set1_epi64(h);
+  __m512i pv = _mm512_set1_epi64(packed);
+  __m512i mv = _mm512_set1_epi64(mask);
+  int i = 0;
+  for (; i + 8 <= n; i += 8)
+  {
+    __m512i pcs = _mm512_cvtepu32_epi64(_mm256_loadu_si256((const __m256i *)(pc + i)));
+    __m512i idx = _mm512_and_si512(_mm512_xor_si512(pcs, history_avx512(hv, pv, i)), mv);
+    _mm256_storeu_si256((__m256i *)(index + i), _mm512_cvtepi64_epi32(idx));
+  }
+  for (; i < n; i++)
+  {
+    index[i] = (pc[i] ^ (uint32_t)history_before(h, packed, i)) & mask;
+  }
+}
+
+__attribute__((target("avx512f"))) static void hist_index_avx512(uint64_t h, uint64_t packed, int n, uint32_t mask, uint32_t *index)
+{
+  __m512i hv = _mm512_set1_epi64(h);
+  __m512i pv = _mm512_set1_epi64(packed);
+  __m512i mv = _mm512_set1_epi64(mask);
+  int i = 0;
+  for (; i + 8 <= n; i += 8)
+  {
+    __m512i idx = _mm512_and_si512(history_avx512(hv, pv, i), mv);
+    _mm256_storeu_si256((__m256i *)(index + i), _mm512_cvtepi64_epi32(idx));
+  }
+  for (; i < n; i++)
+  {
+    index[i] = (uint32_t)history_before(h, packed, i) & mask;
+  }
+}
+
+//------------------------------------//
+//         Dispatched Kernels         //
+//------------------------------------//
+
+void block_xor_index(uint64_t h, uint64_t packed, const uint32_t *pc, int n, uint32_t mask, uint32_t *index)
+{
+  switch (current_isa())
+  {
+  case ISA_AVX512:
+    return xor_index_avx512(h, packed, pc, n, mask, index);
+  case ISA_AVX2:
+    return xor_index_avx2(h, packed, pc, n, mask, index);
+  default:
+    return xor_index_scalar(h, packed, pc, n, mask, index);
+  }
+}
+
+void block_hist_index(uint64_t h, uint64_t packed, int n, uint32_t mask, uint32_t *index)
+{
+  switch (current_isa())
+  {
+  case ISA_AVX512:
+    return hist_index_avx512(h, packed, n, mask, index);
+  case ISA_AVX2:
+    return hist_index_avx2(h, packed, n, mask, index);
+  default:
+    return hist_index_scalar(h, packed, n, mask, index);
+  }
+}
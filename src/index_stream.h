@@ -0,0 +1,44 @@
+//========================================================//
+//  index_stream.h                                        //
+//  Header file for the block index pre-pass              //
+//                                                        //
+//  Global history depends only on the trace's outcomes,  //
+//  so the history each branch of a block will see, and   //
+//  the table indices built from it, can be computed for  //
+//  the whole block before any counter is touched         //
+//========================================================//
+
+#ifndef INDEX_STREAM_H
+#define INDEX_STREAM_H
+
+#include <stdint.h>
+
+// Conditional branches per block: one 64-bit word of outcomes
+#define BLOCK_BRANCHES 64
+
+// Outcomes of a block packed with branch 0 in bit 63, branch 1 in bit 62, ...
+// so the global history before branch i is (h << i) | (packed >> (64 - i))
+//
+uint64_t block_pack_outcomes(const uint8_t *outcome, int n);
+
+// Global history after the block's n branches
+//
+static inline uint64_t block_history_after(uint64_t h, uint64_t packed, int n)
+{
+  return n == 0 ? h : n == 64 ? packed : (h << n) | (packed >> (64 - n));
+}
+
+// index[i] = (pc[i] ^ hist_i) & mask, hist_i = global history before
+// branch i of the block starting with history 'h'
+//
+void block_xor_index(uint64_t h, uint64_t packed, const uint32_t *pc, int n, uint32_t mask, uint32_t *index);
+
+// index[i] = hist_i & mask
+//
+void block_hist_index(uint64_t h, uint64_t packed, int n, uint32_t mask, uint32_t *index);
+
+// Name of the instruction set the kernels run with ("avx512", "avx2" or "scalar")
+//
+const char *block_index_isa();
+
+#endif
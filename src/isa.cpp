@@ -0,0 +1,46 @@
+//========================================================//
+//  isa.cpp                                               //
+//  Source file for SIMD kernel dispatch                  //
+//========================================================//
+#include <stdio.h>
+#include <string.h>
+#include "isa.h"
+
+int activeIsa = -1;
+const char *isaName[ISA_COUNT] = {"scalar", "avx2", "avx512"};
+
+static int host_isa()
+{
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw") &&
+      __builtin_cpu_supports("avx512vl") && __builtin_cpu_supports("bmi2"))
+    return ISA_AVX512;
+  if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("bmi2"))
+    return ISA_AVX2;
+  return ISA_SCALAR;
+}
+
+int init_isa(int forced)
+{
+  int host = host_isa();
+  activeIsa = host;
+  if (forced >= 0 && forced < host)
+  {
+    activeIsa = forced;
+  }
+  else if (forced > host)
+  {
+    fprintf(stderr, "Warning: this CPU has no %s, running %s kernels\n", isaName[forced], isaName[host]);
+  }
+  return activeIsa;
+}
+
+int parse_isa(const char *name)
+{
+  for (int i = 0; i < ISA_COUNT; i++)
+  {
+    if (!strcmp(name, isaName[i]))
+      return i;
+  }
+  return -1;
+}
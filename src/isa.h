@@ -0,0 +1,40 @@
+//========================================================//
+//  isa.h                                                 //
+//  Header file for SIMD kernel dispatch                  //
+//                                                        //
+//  The build targets baseline x86-64; kernels that have  //
+//  AVX2 or AVX-512 variants (compiled with target        //
+//  attributes) pick one from the CPU's features at       //
+//  startup, or from --force-isa                          //
+//========================================================//
+
+#ifndef ISA_H
+#define ISA_H
+
+#define ISA_SCALAR 0 // plain C (baseline x86-64 includes SSE2)
+#define ISA_AVX2 1   // AVX2 + BMI2
+#define ISA_AVX512 2 // AVX-512 F/BW/VL
+#define ISA_COUNT 3
+
+extern int activeIsa; // what the kernels run with, set by init_isa()
+extern const char *isaName[ISA_COUNT];
+
+// Detect the widest supported instruction set; 'forced' >= 0 caps it
+// (forcing a set the CPU lacks falls back to the best it has).
+// Returns the instruction set chosen.
+//
+int init_isa(int forced);
+
+// The active instruction set, detecting it on first use if init_isa()
+// has not been called
+//
+static inline int current_isa()
+{
+  return activeIsa >= 0 ? activeIsa : init_isa(-1);
+}
+
+// Parse an instruction set name, -1 if unknown
+//
+int parse_isa(const char *name);
+
+#endif
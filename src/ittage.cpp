@@ -0,0 +1,230 @@
+//========================================================//
+//  ittage.cpp                                            //
+//  Source file for the indirect target predictor         //
+//                                                        //
+//  Seznec, "A 64-Kbytes ITTAGE indirect branch           //
+//  predictor" (JWAC-2, 2011), without the region table   //
+//========================================================//
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "ittage.h"
+#include "history.h"
+#include "packed_array.h"
+#include "sat_counter.h"
+
+//------------------------------------//
+//       ITTAGE Configuration         //
+//------------------------------------//
+int ittageMode = 0;
+
+//------------------------------------//
+//       ITTAGE Data Structures       //
+//------------------------------------//
+
+// The base table: last target and a confidence counter per pc
+uint32_t *IttageBaseTarget;
+PackedArray<2> IttageBaseCtr;
+
+// Tagged tables, one array per field (table t's entries at t << ITTAGE_BITS)
+uint16_t *IttageTag;
+uint32_t *IttageTarget;
+PackedArray<2> IttageCtr;    // confidence in the target; at 0 a miss replaces it
+PackedArray<1> IttageUseful; // right where the alternate was wrong
+
+int IttageHist[ITTAGE_TABLES + 1];
+LongHistory ghistory_ittage; // conditional outcomes and two target bits per indirect branch
+FoldedHistory IttageFold[ITTAGE_TABLES + 1];
+FoldedHistory IttageTagFold[ITTAGE_TABLES + 1];
+FoldedHistory IttageTagFold2[ITTAGE_TABLES + 1];
+
+uint64_t ittageIndirect;          // indirect jumps and calls predicted
+uint64_t ittageMispredicts;
+uint64_t ittageProvided[ITTAGE_TABLES + 1]; // predictions by provider, 0 = base table
+uint64_t ittageProviderWrong[ITTAGE_TABLES + 1];
+
+//------------------------------------//
+//         ITTAGE Functions           //
+//------------------------------------//
+
+void init_ittage()
+{
+  IttageBaseTarget = (uint32_t *)calloc(1 << ITTAGE_BASE_BITS, sizeof(uint32_t));
+  IttageBaseCtr.init(1 << ITTAGE_BASE_BITS, 0);
+  IttageTag = (uint16_t *)calloc((ITTAGE_TABLES + 1) << ITTAGE_BITS, sizeof(uint16_t));
+  IttageTarget = (uint32_t *)calloc((ITTAGE_TABLES + 1) << ITTAGE_BITS, sizeof(uint32_t));
+  IttageCtr.init((ITTAGE_TABLES + 1) << ITTAGE_BITS, 0);
+  IttageUseful.init((ITTAGE_TABLES + 1) << ITTAGE_BITS, 0);
+
+  double ratio = pow((double)ITTAGE_MAX_HIST / ITTAGE_MIN_HIST, 1.0 / (ITTAGE_TABLES - 1));
+  for (int t = 1; t <= ITTAGE_TABLES; t++)
+  {
+    IttageHist[t] = (int)(ITTAGE_MIN_HIST * pow(ratio, t - 1) + 0.5);
+    IttageFold[t].init(IttageHist[t], ITTAGE_BITS);
+    IttageTagFold[t].init(IttageHist[t], ITTAGE_TAG_BITS);
+    IttageTagFold2[t].init(IttageHist[t], ITTAGE_TAG_BITS - 1);
+  }
+  ghistory_ittage.init(ITTAGE_MAX_HIST + 1);
+
+  ittageIndirect = 0;
+  ittageMispredicts = 0;
+  for (int t = 0; t <= ITTAGE_TABLES; t++)
+  {
+    ittageProvided[t] = 0;
+    ittageProviderWrong[t] = 0;
+  }
+}
+
+static inline uint32_t ittage_index(int t, uint32_t pc)
+{
+  return (t << ITTAGE_BITS) | ((pc ^ (pc >> ITTAGE_BITS) ^ IttageFold[t].value) & ((1 << ITTAGE_BITS) - 1));
+}
+
+static inline uint16_t ittage_tag(int t, uint32_t pc)
+{
+  return (pc ^ IttageTagFold[t].value ^ (IttageTagFold2[t].value << 1)) & ((1 << ITTAGE_TAG_BITS) - 1);
+}
+
+static void ittage_push(uint32_t bit)
+{
+  ghistory_ittage.push(bit);
+  for (int t = 1; t <= ITTAGE_TABLES; t++)
+  {
+    uint32_t out = ghistory_ittage.bit(IttageHist[t]);
+    IttageFold[t].update(bit, out);
+    IttageTagFold[t].update(bit, out);
+    IttageTagFold2[t].update(bit, out);
+  }
+}
+
+// Predict and train one indirect jump or call
+static int ittage_predict_train(uint32_t pc, uint32_t target)
+{
+  uint32_t base = pc & ((1 << ITTAGE_BASE_BITS) - 1);
+  uint32_t index[ITTAGE_TABLES + 1];
+  uint16_t tag[ITTAGE_TABLES + 1];
+  int provider = 0, alt = 0;
+  for (int t = ITTAGE_TABLES; t >= 1; t--)
+  {
+    index[t] = ittage_index(t, pc);
+    tag[t] = ittage_tag(t, pc);
+    if (IttageTag[index[t]] == tag[t])
+    {
+      if (!provider)
+        provider = t;
+      else if (!alt)
+        alt = t;
+    }
+  }
+
+  // the provider's target, unless it has no confidence left and there is an alternate
+  uint32_t altTarget = alt ? IttageTarget[index[alt]] : IttageBaseTarget[base];
+  uint32_t providerTarget = provider ? IttageTarget[index[provider]] : altTarget;
+  int useAlt = provider && IttageCtr.get(index[provider]) == 0;
+  uint32_t predicted = useAlt ? altTarget : providerTarget;
+
+  ittageIndirect++;
+  ittageMispredicts += predicted != target;
+  int source = useAlt ? alt : provider;
+  ittageProvided[source]++;
+  ittageProviderWrong[source] += predicted != target;
+
+  // confidence counters: a miss at 0 replaces the target
+  if (provider)
+  {
+    uint32_t i = index[provider];
+    if (providerTarget == target)
+      IttageCtr.set(i, SatCounter<2>::inc(IttageCtr.get(i)));
+    else if (IttageCtr.get(i) > 0)
+      IttageCtr.set(i, IttageCtr.get(i) - 1);
+    else
+      IttageTarget[i] = target;
+    if ((providerTarget == target) != (altTarget == target))
+      IttageUseful.set(i, providerTarget == target);
+  }
+  if (!provider || useAlt)
+  {
+    if (alt)
+    {
+      uint32_t i = index[alt];
+      if (altTarget == target)
+        IttageCtr.set(i, SatCounter<2>::inc(IttageCtr.get(i)));
+      else if (IttageCtr.get(i) > 0)
+        IttageCtr.set(i, IttageCtr.get(i) - 1);
+    }
+    else if (IttageBaseTarget[base] == target)
+      IttageBaseCtr.set(base, SatCounter<2>::inc(IttageBaseCtr.get(base)));
+    else if (IttageBaseCtr.get(base) > 0)
+      IttageBaseCtr.set(base, IttageBaseCtr.get(base) - 1);
+    else
+      IttageBaseTarget[base] = target;
+  }
+
+  // on a miss, allocate in one longer table whose entry isn't useful; if all are, free them up
+  if (predicted != target && provider < ITTAGE_TABLES)
+  {
+    int allocated = 0;
+    for (int t = provider + 1; t <= ITTAGE_TABLES && !allocated; t++)
+    {
+      if (IttageUseful.get(index[t]) == 0)
+      {
+        IttageTag[index[t]] = tag[t];
+        IttageTarget[index[t]] = target;
+        IttageCtr.set(index[t], 0);
+        allocated = 1;
+      }
+    }
+    for (int t = provider + 1; t <= ITTAGE_TABLES && !allocated; t++)
+    {
+      IttageUseful.set(index[t], 0);
+    }
+  }
+  return predicted != target;
+}
+
+int ittage_update(const branchRecord &b)
+{
+  if (b.condition)
+  {
+    ittage_push(b.outcome);
+    return 0;
+  }
+  if (b.direct || b.ret)
+  {
+    return 0;
+  }
+  int wrong = ittage_predict_train(b.pc, b.target);
+  // two target bits per indirect branch, so the tables see which way it went
+  ittage_push((b.target >> 2) & 1);
+  ittage_push((b.target >> 3) & 1);
+  return wrong;
+}
+
+void ittage_report(uint64_t num_branches)
+{
+  printf("\nIndirect targets (ITTAGE, %d tagged tables, histories %d..%d):\n", ITTAGE_TABLES,
+         IttageHist[1], IttageHist[ITTAGE_TABLES]);
+  printf("  indirect jumps/calls: %10llu\n", (unsigned long long)ittageIndirect);
+  printf("  target mispredicts:   %10llu\n", (unsigned long long)ittageMispredicts);
+  printf("  per 1000 branches:    %10.3f\n", 1000.0 * ittageMispredicts / (num_branches ? num_branches : 1));
+  printf("  per 1000 indirect:    %10.3f\n", 1000.0 * ittageMispredicts / (ittageIndirect ? ittageIndirect : 1));
+  printf("  %-10s %12s %12s\n", "provider", "predictions", "mispredicts");
+  for (int t = 0; t <= ITTAGE_TABLES; t++)
+  {
+    char name[16];
+    snprintf(name, sizeof(name), t ? "ittage[%d]" : "base", t);
+    printf("  %-10s %12llu %12llu\n", name, (unsigned long long)ittageProvided[t],
+           (unsigned long long)ittageProviderWrong[t]);
+  }
+}
+
+void cleanup_ittage()
+{
+  free(IttageBaseTarget);
+  IttageBaseCtr.release();
+  free(IttageTag);
+  free(IttageTarget);
+  IttageCtr.release();
+  IttageUseful.release();
+  ghistory_ittage.release();
+}
@@ -0,0 +1,65 @@
+//========================================================//
+//  ittage.h                                              //
+//  Header file for the indirect target predictor         //
+//                                                        //
+//  ITTAGE: a pc-indexed base table of targets plus       //
+//  tagged tables on geometric history lengths, the       //
+//  longest match providing the predicted target          //
+//========================================================//
+
+#ifndef ITTAGE_H
+#define ITTAGE_H
+
+#include <stdint.h>
+#include "predictor.h"
+#include "budget.h"
+
+//------------------------------------//
+//       ITTAGE Configuration         //
+//------------------------------------//
+#define ITTAGE_TABLES 8
+#define ITTAGE_BASE_BITS 10   // 2^10 base entries
+#define ITTAGE_BITS 9         // 2^9 entries per tagged table
+#define ITTAGE_TAG_BITS 11
+#define ITTAGE_TARGET_BITS 32 // full targets; real designs share high bits through a region table
+#define ITTAGE_MIN_HIST 4
+#define ITTAGE_MAX_HIST 256
+
+extern int ittageMode; // Non-zero when --ittage was given
+
+// Tags, targets, 2-bit confidence and 1-bit useful counters, the history
+// register and each tagged table's three folds
+constexpr Budget<7> ittage_budget()
+{
+  return {{{"IttageBase", 1ull << ITTAGE_BASE_BITS, ITTAGE_TARGET_BITS + 2},
+           {"IttageTag", (uint64_t)ITTAGE_TABLES << ITTAGE_BITS, ITTAGE_TAG_BITS},
+           {"IttageTarget", (uint64_t)ITTAGE_TABLES << ITTAGE_BITS, ITTAGE_TARGET_BITS},
+           {"IttageCtr", (uint64_t)ITTAGE_TABLES << ITTAGE_BITS, 2},
+           {"IttageUseful", (uint64_t)ITTAGE_TABLES << ITTAGE_BITS, 1},
+           {"ghistory_ittage", 1, ITTAGE_MAX_HIST},
+           {"IttageFold", ITTAGE_TABLES, ITTAGE_BITS + 2 * ITTAGE_TAG_BITS - 1}}};
+}
+
+//------------------------------------//
+//     ITTAGE Function Prototypes     //
+//------------------------------------//
+
+void init_ittage();
+
+// Predict the target of 'b' if it is an indirect jump or call (direct
+// == 0, returns are left to a return stack), then train with the real
+// target. Every record moves the history.
+//
+// Returns 1 if the target was mispredicted
+//
+int ittage_update(const branchRecord &b);
+
+// Print the target mispredictions, per 1000 of 'num_branches'
+// conditional branches (the direction rate's unit) and per 1000
+// indirect branches, broken down by provider
+//
+void ittage_report(uint64_t num_branches);
+
+void cleanup_ittage();
+
+#endif
@@ -0,0 +1,131 @@
+//========================================================//
+//  loop.cpp                                              //
+//  Source file for the loop predictor                    //
+//                                                        //
+//  An entry counts the iterations of its branch's runs;  //
+//  a run ends when the branch leaves its usual direction //
+//========================================================//
+#include "loop.h"
+
+#define LOOP_CONF_MAX ((1 << LOOP_CONF_BITS) - 1)
+#define LOOP_AGE_MAX ((1 << LOOP_AGE_BITS) - 1)
+#define LOOP_ITER_MAX ((1 << LOOP_ITER_BITS) - 1)
+
+void init_loop(LoopTable &l, int bits, Arena *arena)
+{
+  uint32_t entries = 1 << bits;
+  l.bits = bits;
+  l.tag.init(entries, 0, arena);
+  l.past.init(entries, 0, arena);
+  l.current.init(entries, 0, arena);
+  l.conf.init(entries, 0, arena);
+  l.age.init(entries, 0, arena);
+  l.dir.init(entries, 0, arena);
+}
+
+static inline uint32_t loop_index(const LoopTable &l, uint32_t pc)
+{
+  return (pc ^ (pc >> l.bits)) & ((1 << l.bits) - 1);
+}
+
+static inline uint32_t loop_tag(const LoopTable &l, uint32_t pc)
+{
+  return (pc >> l.bits) & ((1 << LOOP_TAG_BITS) - 1);
+}
+
+// The branch leaves the loop on the iteration after the past trip count's last
+static inline uint8_t loop_direction(const LoopTable &l, uint32_t i)
+{
+  uint32_t dir = l.dir.get(i);
+  return l.current.get(i) + 1 == l.past.get(i) ? !dir : dir;
+}
+
+int loop_predict(const LoopTable &l, uint32_t pc, uint8_t *prediction)
+{
+  uint32_t i = loop_index(l, pc);
+  if (l.tag.get(i) != loop_tag(l, pc) || l.conf.get(i) != LOOP_CONF_MAX)
+  {
+    return 0;
+  }
+  *prediction = loop_direction(l, i);
+  return 1;
+}
+
+static void loop_free(LoopTable &l, uint32_t i)
+{
+  l.past.set(i, 0);
+  l.current.set(i, 0);
+  l.conf.set(i, 0);
+  l.age.set(i, 0);
+}
+
+void train_loop(LoopTable &l, uint32_t pc, uint8_t outcome, uint8_t otherPrediction)
+{
+  uint32_t i = loop_index(l, pc);
+  if (l.tag.get(i) != loop_tag(l, pc))
+  {
+    // allocate on the other predictor's mispredictions, most likely a loop exit,
+    // once the entry there has aged out
+    if (otherPrediction != outcome)
+    {
+      uint32_t age = l.age.get(i);
+      if (age > 0)
+      {
+        l.age.set(i, age - 1);
+        return;
+      }
+      l.tag.set(i, loop_tag(l, pc));
+      l.dir.set(i, !outcome);
+      l.past.set(i, 0);
+      l.current.set(i, 0);
+      l.conf.set(i, 0);
+      l.age.set(i, LOOP_AGE_MAX);
+    }
+    return;
+  }
+
+  if (l.conf.get(i) == LOOP_CONF_MAX)
+  {
+    uint8_t prediction = loop_direction(l, i);
+    if (prediction != outcome) // the trip count changed
+    {
+      loop_free(l, i);
+      return;
+    }
+    if (prediction != otherPrediction) // the entry is earning its place
+    {
+      l.age.set(i, SatCounter<LOOP_AGE_BITS>::inc(l.age.get(i)));
+    }
+  }
+
+  uint32_t current = l.current.get(i) + 1;
+  if (current == LOOP_ITER_MAX) // longer than an entry can count
+  {
+    loop_free(l, i);
+    return;
+  }
+  if (outcome != l.dir.get(i)) // the run ended
+  {
+    if (current == l.past.get(i))
+    {
+      l.conf.set(i, SatCounter<LOOP_CONF_BITS>::inc(l.conf.get(i)));
+    }
+    else
+    {
+      l.past.set(i, current);
+      l.conf.set(i, 0);
+    }
+    current = 0;
+  }
+  l.current.set(i, current);
+}
+
+void cleanup_loop(LoopTable &l)
+{
+  l.tag.release();
+  l.past.release();
+  l.current.release();
+  l.conf.release();
+  l.age.release();
+  l.dir.release();
+}
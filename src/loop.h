@@ -0,0 +1,67 @@
+//========================================================//
+//  loop.h                                                //
+//  Header file for the loop predictor                    //
+//                                                        //
+//  Tagged entries learn a branch's trip count: once the  //
+//  same count has been seen a few times in a row, the    //
+//  entry predicts the exit iteration exactly             //
+//========================================================//
+
+#ifndef LOOP_H
+#define LOOP_H
+
+#include <stdint.h>
+#include "budget.h"
+#include "arena.h"
+#include "packed_array.h"
+
+// Entry fields, in bits
+#define LOOP_TAG_BITS 10
+#define LOOP_ITER_BITS 10 // trip counts up to 1023
+#define LOOP_CONF_BITS 2  // predicts once the count repeated 3 times
+#define LOOP_AGE_BITS 3   // replacement: only entries aged to 0 are replaced
+#define LOOP_DIR_BITS 1   // direction the loop stays in
+
+// log2 entries (default 6: 64 entries)
+#define LOOP_BITS_DEFAULT 6
+
+// One loop predictor's entries, direct mapped, each field in its own
+// packed array like the other predictors' tables
+struct LoopTable
+{
+  int bits;
+  PackedArray<LOOP_TAG_BITS> tag;      // pc bits above the index
+  PackedArray<LOOP_ITER_BITS> past;    // trip count of the last complete run (0 = none yet)
+  PackedArray<LOOP_ITER_BITS> current; // iterations of the current run so far
+  PackedArray<LOOP_CONF_BITS> conf;    // runs in a row that matched 'past'
+  PackedArray<LOOP_AGE_BITS> age;
+  PackedArray<LOOP_DIR_BITS> dir;
+};
+
+constexpr Budget<6> loop_budget(int bits)
+{
+  return {{{"LoopTag", 1ull << bits, LOOP_TAG_BITS},
+           {"LoopPast", 1ull << bits, LOOP_ITER_BITS},
+           {"LoopCurrent", 1ull << bits, LOOP_ITER_BITS},
+           {"LoopConf", 1ull << bits, LOOP_CONF_BITS},
+           {"LoopAge", 1ull << bits, LOOP_AGE_BITS},
+           {"LoopDir", 1ull << bits, LOOP_DIR_BITS}}};
+}
+
+// Allocate 2^bits entries (from 'arena' if given), all free
+//
+void init_loop(LoopTable &l, int bits, Arena *arena);
+
+// Returns 1 and sets *prediction when 'pc' has a confident entry
+//
+int loop_predict(const LoopTable &l, uint32_t pc, uint8_t *prediction);
+
+// Train with the branch's outcome. 'otherPrediction' is what the
+// predictor the loop predictor backs up predicted: entries are
+// allocated on its mispredictions and age while they disagree with it
+//
+void train_loop(LoopTable &l, uint32_t pc, uint8_t outcome, uint8_t otherPrediction);
+
+void cleanup_loop(LoopTable &l);
+
+#endif
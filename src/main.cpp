@@ -8,10 +8,34 @@
 #include <stdlib.h>
 #include <string.h>
 #include "predictor.h"
+#include "alias.h"
+#include "oracle.h"
+#include "entropy.h"
+#include "digest.h"
+#include "index_stream.h"
+#include "sweep.h"
+#include "trace.h"
+#include "isa.h"
+#include "perceptron.h"
+#include "mpp.h"
+#include "ittage.h"
+#include "btb.h"
+#include "frontend.h"
 
 FILE *stream;
-char *buf = NULL;
-size_t len = 0;
+int forceIsa = -1; // --force-isa, -1 = the widest the CPU supports
+int tlbMode = 0; // 1 = report dTLB misses, 2 = the perf counter is unavailable
+int statsMode = 0; // --stats
+const char *summaryFile = NULL; // --summary, default ../traces/<trace>.txt
+
+// Lookahead window: branches read from the trace but not yet simulated.
+// Each conditional branch entering the window has its table entries
+// prefetched, 'prefetchDistance' branches before it is predicted.
+#define PREFETCH_MAX 256
+branchRecord window[PREFETCH_MAX + 1];
+int windowHead = 0;
+int windowCount = 0;
+int prefetchDistance = 0;
 
 // Print out the Usage information to stderr
 //
@@ -22,11 +46,76 @@ void usage()
   fprintf(stderr, " Options:\n");
   fprintf(stderr, " --help       Print this message\n");
   fprintf(stderr, " --verbose    Print predictions on stdout\n");
+  fprintf(stderr, " --alias[:<min>:<max>]\n"
+                  "              Classify table aliasing for sizes 2^min..2^max\n");
+  fprintf(stderr, " --oracle[:<hist>]\n"
+                  "              Compare against unbounded bimodal/gshare/local predictors;\n"
+                  "              the gshare one keys on <hist> bits of global history\n"
+                  "              (max 64, default the predictor's)\n");
+  fprintf(stderr, " --sweep[:<min>:<max>[:<step>]]\n"
+                  "              Simulate gshare with tables of 2^min..2^max entries and\n"
+                  "              histories 0, step, ..., bits in one pass (default 10:18:2)\n");
+  fprintf(stderr, " --sweep-check[:<min>:<max>[:<step>]]\n"
+                  "              Sweep and check every lane against the scalar gshare update\n");
+  fprintf(stderr, " --ittage     Predict indirect jump and call targets with ITTAGE\n");
+  fprintf(stderr, " --btb[:<entries>:<ways>[:<lru|fifo|random>]]\n"
+                  "              Simulate a branch target buffer (default 4096:4:lru)\n"
+                  "              and a return address stack\n");
+  fprintf(stderr, " --ras[:<depth>[:<wrap|drop>]]\n"
+                  "              Return stack depth and overflow handling (default 16:wrap)\n");
+  fprintf(stderr, " --frontend[:<width>:<block>[:<direction>:<target>:<btb>]]\n"
+                  "              Front-end timing: instructions per cycle from a fetch block\n"
+                  "              of <block> bytes (default 4:32) and redirect penalties in\n"
+                  "              cycles (default 14:14:3);\n"
+                  "              reports lost cycles and IPC (implies --btb)\n");
+  fprintf(stderr, " --summary:<file>\n"
+                  "              Trace summary with the instruction count\n"
+                  "              (default ../traces/<trace>.txt)\n");
+  fprintf(stderr, " --entropy[:<file>]\n"
+                  "              Per-branch bias/entropy table (default entropy.tsv)\n");
+  fprintf(stderr, " --digest[:<trace>]\n"
+                  "              Check the prediction stream against the golden file\n");
+  fprintf(stderr, " --digest-update[:<trace>]\n"
+                  "              Store the prediction stream digest in the golden file,\n"
+                  "              and its exceptions that name the first divergent branch\n");
+  fprintf(stderr, " --digest-file:<file>  Golden file (default ../traces/golden_digests.txt)\n");
+  fprintf(stderr, " --digest-bits:<file>  Save, or compare with, the raw prediction bitstream\n");
+  fprintf(stderr, " --arena:<off|4k|thp|hugetlb>\n"
+                  "              Backing of the predictor tables (default thp)\n");
+  fprintf(stderr, " --force-isa:<scalar|avx2|avx512>\n"
+                  "              Run the SIMD kernels with at most this instruction set\n");
+  fprintf(stderr, " --tlb        Report the table arena and dTLB load misses\n");
+  fprintf(stderr, " --stats      Report which component made each prediction\n");
+  fprintf(stderr, " --loop[:<bits>]\n"
+                  "              Let a loop predictor of 2^bits entries (default 6)\n"
+                  "              override the predictor and report what it removed\n");
+  fprintf(stderr, " --delay:<n>  Apply each table update n conditional branches after its\n"
+                  "              prediction (max 4096); histories still update at once\n");
+  fprintf(stderr, " --override:<latency>:<type>[:<args>]\n"
+                  "              Let the scheme below override a fast <type> predictor\n"
+                  "              (e.g. gshare, perceptron:31:8) after <latency> cycles\n"
+                  "              and report the overrides, bubbles and net cycles saved\n");
+  fprintf(stderr, " --spec-history[:<resolve>]\n"
+                  "              Shift predictions into the global history and repair a\n"
+                  "              misprediction's bit <resolve> branches later (max 4096,\n"
+                  "              default 0: before the next branch). The trace holds only\n"
+                  "              the correct path, so at 0 the history equals the true one\n"
+                  "              by design; above 0 the branches in between stand in for\n"
+                  "              squashed work, compared with a first pass on true outcomes\n");
+  fprintf(stderr, " --prefetch:<distance>\n"
+                  "              Prefetch table entries this many branches ahead (max 256)\n");
   fprintf(stderr, " --<type>     Branch prediction scheme:\n");
   fprintf(stderr, "    static\n"
                   "    gshare\n"
                   "    tournament\n"
-                  "    custom\n");
+                  "    custom[:<min>:<max>]\n"
+                  "              (TAGE-SC-L, history lengths of the 12 tagged tables\n"
+                  "               geometric from min to max <= 2048; default 4:640)\n"
+                  "    perceptron[:<hist>:<bits>]\n"
+                  "              (history length up to 63, 2^bits perceptrons; default 63:9)\n"
+                  "    mpp[:<bits>[:<features>]]\n"
+                  "              (multiperspective, 2^bits weights per feature, default 11;\n"
+                  "               features: comma separated b, g<a>-<b>, l<n>, p<n>, d)\n");
 }
 
 // Process an option and update the predictor
@@ -51,11 +140,228 @@ int handle_option(char *arg)
   else if (!strncmp(arg, "--custom", 8))
   {
     bpType = CUSTOM;
+    sscanf(arg + 8, ":%d:%d", &TageMinHist, &TageMaxHist);
+    if (TageMinHist < 1 || TageMaxHist <= TageMinHist || TageMaxHist > TAGE_MAX_HIST)
+    {
+      return 0;
+    }
+  }
+  else if (!strncmp(arg, "--perceptron", 12))
+  {
+    bpType = PERCEPTRON;
+    sscanf(arg + 12, ":%d:%d", &PerceptronHist, &PerceptronBits);
+    if (PerceptronHist < 1 || PerceptronHist > PERCEPTRON_MAX_HIST || PerceptronBits < 0 || PerceptronBits > 24)
+    {
+      return 0;
+    }
+  }
+  else if (!strncmp(arg, "--mpp", 5))
+  {
+    bpType = MULTIPERSPECTIVE;
+    char features[256] = "";
+    sscanf(arg + 5, ":%d:%255s", &MppBits, features);
+    if (MppBits < 1 || MppBits > 20)
+    {
+      return 0;
+    }
+    if (features[0])
+    {
+      MppCount = mpp_parse_features(features, MppFeatures);
+      if (MppCount <= 0)
+      {
+        return 0;
+      }
+    }
+  }
+  else if (!strncmp(arg, "--loop", 6))
+  {
+    LoopMode = 1;
+    sscanf(arg + 6, ":%d", &LoopBits);
+    if (LoopBits < 1 || LoopBits > 16)
+    {
+      return 0;
+    }
+  }
+  else if (!strncmp(arg, "--delay:", 8))
+  {
+    UpdateDelay = atoi(arg + 8);
+    if (UpdateDelay < 0 || UpdateDelay > UPDATE_DELAY_MAX)
+    {
+      return 0;
+    }
+  }
+  else if (!strncmp(arg, "--override:", 11))
+  {
+    // the fast predictor's own option sets bpType like any scheme would
+    char *type = NULL;
+    OverrideLatency = strtol(arg + 11, &type, 10);
+    if (type == arg + 11 || *type != ':' || OverrideLatency < 0)
+    {
+      return 0;
+    }
+    char fast[256];
+    snprintf(fast, sizeof(fast), "--%s", type + 1);
+    int slow = bpType;
+    bpType = -1;
+    int ok = handle_option(fast);
+    OverrideType = bpType;
+    bpType = slow;
+    if (!ok || OverrideType < 0)
+    {
+      return 0;
+    }
+  }
+  else if (!strncmp(arg, "--spec-history", 14))
+  {
+    SpecHistory = 1;
+    sscanf(arg + 14, ":%d", &SpecResolve);
+    if (SpecResolve < 0 || SpecResolve > SPEC_RESOLVE_MAX)
+    {
+      return 0;
+    }
+  }
+  else if (!strcmp(arg, "--stats"))
+  {
+    statsMode = 1;
   }
   else if (!strcmp(arg, "--verbose"))
   {
     verbose = 1;
   }
+  else if (!strncmp(arg, "--alias", 7))
+  {
+    aliasMode = 1;
+    sscanf(arg + 7, ":%d:%d", &aliasMinBits, &aliasMaxBits);
+  }
+  else if (!strncmp(arg, "--sweep-check", 13))
+  {
+    sweepMode = 2;
+    sscanf(arg + 13, ":%d:%d:%d", &sweepMinBits, &sweepMaxBits, &sweepHistStep);
+  }
+  else if (!strncmp(arg, "--sweep", 7))
+  {
+    sweepMode = 1;
+    sscanf(arg + 7, ":%d:%d:%d", &sweepMinBits, &sweepMaxBits, &sweepHistStep);
+  }
+  else if (!strcmp(arg, "--ittage"))
+  {
+    ittageMode = 1;
+  }
+  else if (!strncmp(arg, "--btb", 5))
+  {
+    btbMode = 1;
+    char policy[16] = "";
+    sscanf(arg + 5, ":%d:%d:%15s", &btbEntries, &btbWays, policy);
+    if (policy[0])
+    {
+      btbPolicy = parse_btb_policy(policy);
+    }
+    if (btbEntries < 1 || btbWays < 1 || btbWays > BTB_MAX_WAYS || btbWays > btbEntries ||
+        (btbEntries & (btbEntries - 1)) || (btbWays & (btbWays - 1)) || btbPolicy < 0)
+    {
+      return 0;
+    }
+  }
+  else if (!strncmp(arg, "--ras", 5))
+  {
+    btbMode = 1;
+    char overflow[16] = "";
+    sscanf(arg + 5, ":%d:%15s", &rasDepth, overflow);
+    if (overflow[0])
+    {
+      rasOverflow = parse_ras_overflow(overflow);
+    }
+    if (rasDepth < 1 || rasDepth > RAS_MAX_DEPTH || rasOverflow < 0)
+    {
+      return 0;
+    }
+  }
+  else if (!strncmp(arg, "--frontend", 10))
+  {
+    frontendMode = 1;
+    btbMode = 1;
+    sscanf(arg + 10, ":%d:%d:%d:%d:%d", &frontendWidth, &frontendBlock, &penaltyDirection, &penaltyTarget,
+           &penaltyBtb);
+    if (frontendWidth < 1 || frontendWidth > FRONTEND_MAX_WIDTH || frontendBlock < 1 ||
+        frontendBlock > FRONTEND_MAX_BLOCK || (frontendBlock & (frontendBlock - 1)) ||
+        penaltyDirection < 0 || penaltyTarget < 0 || penaltyBtb < 0)
+    {
+      return 0;
+    }
+  }
+  else if (!strncmp(arg, "--summary:", 10))
+  {
+    summaryFile = arg + 10;
+  }
+  else if (!strncmp(arg, "--oracle", 8))
+  {
+    oracleMode = 1;
+    sscanf(arg + 8, ":%d", &oracleHistBits);
+  }
+  else if (!strncmp(arg, "--digest-update", 15))
+  {
+    digestMode = DIGEST_UPDATE;
+    if (arg[15] == ':')
+    {
+      digestTrace = arg + 16;
+    }
+  }
+  else if (!strncmp(arg, "--digest-file:", 14))
+  {
+    digestFile = arg + 14;
+  }
+  else if (!strncmp(arg, "--digest-bits:", 14))
+  {
+    digestBits = arg + 14;
+  }
+  else if (!strncmp(arg, "--digest", 8))
+  {
+    digestMode = DIGEST_CHECK;
+    if (arg[8] == ':')
+    {
+      digestTrace = arg + 9;
+    }
+  }
+  else if (!strncmp(arg, "--arena:", 8))
+  {
+    for (arenaMode = ARENA_HUGETLB; arenaMode > ARENA_OFF; arenaMode--)
+    {
+      if (!strcmp(arg + 8, arenaModeName[arenaMode]))
+        break;
+    }
+    if (strcmp(arg + 8, arenaModeName[arenaMode]))
+    {
+      return 0;
+    }
+  }
+  else if (!strncmp(arg, "--prefetch:", 11))
+  {
+    prefetchDistance = atoi(arg + 11);
+    if (prefetchDistance < 0 || prefetchDistance > PREFETCH_MAX)
+    {
+      return 0;
+    }
+  }
+  else if (!strncmp(arg, "--force-isa:", 12))
+  {
+    forceIsa = parse_isa(arg + 12);
+    if (forceIsa < 0)
+    {
+      return 0;
+    }
+  }
+  else if (!strcmp(arg, "--tlb"))
+  {
+    tlbMode = 1;
+  }
+  else if (!strncmp(arg, "--entropy", 9))
+  {
+    entropyMode = 1;
+    if (arg[9] == ':')
+    {
+      entropyFile = arg + 10;
+    }
+  }
   else
   {
     return 0;
@@ -65,20 +371,97 @@ int handle_option(char *arg)
 }
 
 // Reads a line from the input stream and extracts the
-// PC and Outcome of a branch
+// PC and Outcome of a branch (see trace.cpp)
 //
 // Returns True if Successful
 //
-int read_branch(uint32_t *pc, uint32_t *target, uint32_t *outcome, uint32_t *condition, uint32_t *call, uint32_t *ret, uint32_t *direct)
+int read_branch(branchRecord *b)
 {
-  if (getline(&buf, &len, stream) == -1)
+  return trace_read(b);
+}
+
+// Returns the next branch of the trace, first topping the lookahead
+// window up to 'prefetchDistance' branches past it
+//
+// Returns True if Successful
+//
+int next_branch(branchRecord *b)
+{
+  while (windowCount <= prefetchDistance)
+  {
+    branchRecord *r = &window[(windowHead + windowCount) % (PREFETCH_MAX + 1)];
+    if (!read_branch(r))
+    {
+      break;
+    }
+    if (prefetchDistance && r->condition)
+    {
+      prefetch_predictor(r->pc, r->outcome);
+    }
+    windowCount++;
+  }
+  if (windowCount == 0)
   {
     return 0;
   }
+  *b = window[windowHead];
+  windowHead = (windowHead + 1) % (PREFETCH_MAX + 1);
+  windowCount--;
+  return 1;
+}
 
-  sscanf(buf, "0x%x\t0x%x\t%d\t%d\t%d\t%d\t%d\n", pc, target, outcome, condition, call, ret, direct);
+// --spec-history:<resolve> compares against the same predictor with the true
+// outcomes in its history: run the trace through it once that way
+// first, then rewind the trace for the main run
+//
+// Returns the mispredictions, -1 if the trace can't be rewound
+//
+int64_t oracle_history_pass()
+{
+  if (fseek(stream, 0, SEEK_SET) != 0)
+  {
+    return -1; // a pipe
+  }
+  SpecHistory = 0;
+  init_predictor();
+  int64_t mispredictions = 0;
+  branchRecord block[BLOCK_BRANCHES];
+  uint8_t blockPrediction[BLOCK_BRANCHES];
+  int blockSize;
+  do
+  {
+    for (blockSize = 0; blockSize < BLOCK_BRANCHES && next_branch(&block[blockSize]); blockSize++)
+      ;
+    simulate_block(block, blockSize, blockPrediction);
+    for (int i = 0; i < blockSize; i++)
+    {
+      mispredictions += block[i].condition && blockPrediction[i] != block[i].outcome;
+    }
+  } while (blockSize == BLOCK_BRANCHES);
+  cleanup_predictor();
+  SpecHistory = 1;
 
-  return 1;
+  trace_close();
+  fseek(stream, 0, SEEK_SET);
+  clearerr(stream);
+  trace_open(stream);
+  return mispredictions;
+}
+
+// Name a trace file is stored under in the golden digest file:
+// its basename without the extension
+//
+const char *trace_name(const char *path)
+{
+  const char *base = strrchr(path, '/');
+  base = base ? base + 1 : path;
+  char *name = strdup(base);
+  char *ext = strchr(name, '.');
+  if (ext)
+  {
+    *ext = 0;
+  }
+  return name;
 }
 
 int main(int argc, char *argv[])
@@ -109,52 +492,243 @@ int main(int argc, char *argv[])
     {
       // Use as input file
       stream = fopen(argv[i], "r");
+      if (digestTrace == NULL)
+      {
+        digestTrace = trace_name(argv[i]);
+      }
     }
   }
 
+  // the pair shares each scheme's configuration, so the two must differ
+  if (OverrideType >= 0 && OverrideType == bpType)
+  {
+    printf("--override needs a fast predictor other than %s\n", bpName[bpType]);
+    exit(1);
+  }
+
+  // Pick the SIMD kernels and open the trace
+  init_isa(forceIsa);
+  trace_open(stream);
+  int64_t oracleMispredictions = 0;
+  if (SpecHistory && SpecResolve > 0)
+  {
+    oracleMispredictions = oracle_history_pass(); // at 0 the two histories are the same
+  }
+
   // Initialize the predictor
   init_predictor();
+  report_budget();
+  if (aliasMode)
+  {
+    init_alias();
+  }
+  if (oracleMode)
+  {
+    init_oracle();
+  }
+  if (ittageMode)
+  {
+    init_ittage();
+    ittage_budget().print("ITTAGE");
+  }
+  if (btbMode)
+  {
+    init_btb();
+    btb_budget(btbEntries, btbWays, btbPolicy, rasDepth).print("BTB");
+  }
+  if (frontendMode)
+  {
+    init_frontend();
+  }
+  if (entropyMode)
+  {
+    init_entropy();
+  }
+  if (sweepMode)
+  {
+    init_sweep();
+  }
+  if (digestMode)
+  {
+    init_digest();
+  }
+
+  uint64_t num_branches = 0;
+  uint64_t num_records = 0;
+  uint64_t mispredictions = 0;
+  branchRecord block[BLOCK_BRANCHES];
+  uint8_t blockPrediction[BLOCK_BRANCHES];
+  int blockSize;
 
-  uint32_t num_branches = 0;
-  uint32_t mispredictions = 0;
-  uint32_t pc = 0;
-  uint32_t target = 0;
-  uint32_t outcome = NOTTAKEN;
-  uint32_t condition = 0;
-  uint32_t call = 0;
-  uint32_t ret = 0;
-  uint32_t direct = 0;
-
-  // Reach each branch from the trace
-  while (read_branch(&pc, &target, &outcome, &condition, &call, &ret, &direct))
-  {
-    if (condition == 1)
-    {
-      num_branches++;
-      // Make a prediction and compare with actual outcome
-      uint32_t prediction = make_prediction(pc, target, direct);
-      if (prediction != outcome)
+  if (tlbMode && !dtlb_open())
+  {
+    tlbMode = 2; // no PMU access, report the arena only
+  }
+  uint64_t dtlbStart = dtlb_read();
+
+  // Reach each block of branches from the trace, predict and train
+  // the predictor over the whole block, then score it
+  do
+  {
+    for (blockSize = 0; blockSize < BLOCK_BRANCHES && next_branch(&block[blockSize]); blockSize++)
+      ;
+    simulate_block(block, blockSize, blockPrediction);
+
+    num_records += blockSize;
+    for (int i = 0; i < blockSize; i++)
+    {
+      uint32_t pc = block[i].pc;
+      uint32_t outcome = block[i].outcome;
+      if (block[i].condition == 1)
       {
-        mispredictions++;
+        num_branches++;
+        // Compare the prediction with actual outcome
+        uint32_t prediction = blockPrediction[i];
+        if (prediction != outcome)
+        {
+          mispredictions++;
+        }
+        if (verbose != 0)
+        {
+          printf("%d\n", prediction);
+        }
+        if (digestMode)
+        {
+          digest_update(prediction, outcome);
+        }
+        if (aliasMode)
+        {
+          alias_update(pc, outcome);
+        }
+        if (oracleMode)
+        {
+          oracle_update(pc, outcome);
+        }
+        if (entropyMode)
+        {
+          entropy_record(pc, outcome);
+        }
+        if (sweepMode)
+        {
+          sweep_update(pc, outcome, prediction);
+        }
       }
-      if (verbose != 0)
+      int targetWrong = -1;
+      int btbFound = 0;
+      if (ittageMode)
       {
-        printf("%d\n", prediction);
+        targetWrong = ittage_update(block[i]);
+      }
+      if (btbMode)
+      {
+        btbFound = btb_update(block[i]);
+      }
+      if (frontendMode)
+      {
+        frontend_update(block[i], block[i].condition && blockPrediction[i] != outcome, btbFound, targetWrong);
       }
     }
-    // Train the predictor
-    train_predictor(pc, target, outcome, condition, call, ret, direct);
-  }
+  } while (blockSize == BLOCK_BRANCHES);
 
   // Print out the mispredict statistics
-  printf("Branches:        %10d\n", num_branches);
-  printf("Incorrect:       %10d\n", mispredictions);
+  printf("Branches:        %10llu\n", (unsigned long long)num_branches);
+  printf("Incorrect:       %10llu\n", (unsigned long long)mispredictions);
   float mispredict_rate = 1000 * ((float)mispredictions / (float)num_branches);
   printf("Misprediction Rate: %7.3f\n", mispredict_rate);
+  if (UpdateDelay)
+  {
+    printf("Update delay:    %10d  branches\n", UpdateDelay);
+  }
+  if (tlbMode)
+  {
+    uint64_t dtlbMisses = dtlb_read() - dtlbStart;
+    dtlb_close();
+    printf("\nTable arena:     %s (%zu bytes)\n",
+           arenaMode == ARENA_OFF ? "off" : arenaModeName[predictorArena.backing()],
+           predictorArena.bytes());
+    if (tlbMode == 1)
+    {
+      printf("dTLB misses:     %10llu  (%.3f per 1000 branches)\n",
+             (unsigned long long)dtlbMisses, 1000.0 * dtlbMisses / (num_branches ? num_branches : 1));
+    }
+    else
+    {
+      printf("dTLB misses:     unavailable (no perf counter access)\n");
+    }
+  }
+  if (LoopMode)
+  {
+    report_loop_override(num_branches);
+  }
+  if (OverrideType >= 0)
+  {
+    report_override(num_branches, mispredictions, penaltyDirection);
+  }
+  if (SpecHistory)
+  {
+    report_spec_history(num_branches, mispredictions, oracleMispredictions);
+  }
+  if (statsMode)
+  {
+    report_predictor_stats();
+  }
+  if (aliasMode)
+  {
+    alias_report();
+    cleanup_alias();
+  }
+  if (oracleMode)
+  {
+    oracle_report(num_branches, mispredictions);
+    cleanup_oracle();
+  }
+  if (ittageMode)
+  {
+    ittage_report(num_branches);
+    cleanup_ittage();
+  }
+  // the summary next to the traces gives the instruction count
+  uint64_t instructions = 0;
+  if (btbMode)
+  {
+    char summary[512];
+    if (summaryFile == NULL && digestTrace != NULL)
+    {
+      snprintf(summary, sizeof(summary), "../traces/%s.txt", digestTrace);
+      summaryFile = summary;
+    }
+    instructions = summaryFile ? trace_instructions(summaryFile) : 0;
+  }
+  if (btbMode)
+  {
+    btb_report(instructions, num_records);
+    cleanup_btb();
+  }
+  if (frontendMode)
+  {
+    frontend_report(instructions);
+  }
+  if (entropyMode)
+  {
+    entropy_report();
+    cleanup_entropy();
+  }
+  if (sweepMode)
+  {
+    sweep_report(num_branches);
+    cleanup_sweep();
+  }
+
+  int status = 0;
+  if (digestMode)
+  {
+    status = digest_finish(num_branches, mispredictions);
+  }
 
   // Cleanup
+  cleanup_predictor();
+  trace_close();
   fclose(stream);
-  free(buf);
 
-  return 0;
+  return status;
 }
@@ -0,0 +1,120 @@
+//========================================================//
+//  mpp.cpp                                               //
+//  Source file for the multiperspective perceptron       //
+//                                                        //
+//  Feature list parsing and the table index hash, which  //
+//  has a scalar and an AVX2 version picked by isa.h      //
+//========================================================//
+#include <stdio.h>
+#include <stdlib.h>
+#include <immintrin.h>
+#include "mpp.h"
+#include "isa.h"
+
+int mpp_parse_features(const char *spec, MppFeature *features)
+{
+  int n = 0;
+  const char *p = spec;
+  while (*p)
+  {
+    if (n == MPP_MAX_FEATURES)
+      return -1;
+    MppFeature f = {0, 0, 0};
+    int used = 0;
+    if (p[0] == 'b')
+    {
+      f.kind = MPP_BIAS;
+      used = 1;
+    }
+    else if (p[0] == 'd')
+    {
+      f.kind = MPP_DEPTH;
+      used = 1;
+    }
+    else if (p[0] == 'g' && sscanf(p, "g%d-%d%n", &f.first, &f.last, &used) == 2)
+    {
+      f.kind = MPP_GLOBAL;
+      if (f.first < 0 || f.last <= f.first || f.last > 64)
+        return -1;
+    }
+    else if (p[0] == 'l' && sscanf(p, "l%d%n", &f.first, &used) == 1)
+    {
+      f.kind = MPP_LOCAL;
+      if (f.first < 1 || f.first > MPP_LOCAL_WIDTH)
+        return -1;
+    }
+    else if (p[0] == 'p' && sscanf(p, "p%d%n", &f.first, &used) == 1)
+    {
+      f.kind = MPP_PATH;
+      if (f.first < 1 || f.first > MPP_PATH_DEPTH)
+        return -1;
+    }
+    else
+    {
+      return -1;
+    }
+    features[n++] = f;
+    p += used;
+    if (*p == ',')
+      p++;
+    else if (*p)
+      return -1;
+  }
+  return n;
+}
+
+//------------------------------------//
+//              Indexing              //
+//------------------------------------//
+
+// 32-bit multiply-xorshift hash of the value (folded to 32 bits) and the pc;
+// the top 'bits' bits select the weight in feature i's table
+static inline uint32_t hash_scalar(uint64_t value, uint32_t pc, int bits)
+{
+  uint32_t key = ((uint32_t)value ^ (uint32_t)(value >> 32)) * 0x9E3779B9u ^ pc * 0x85EBCA6Bu;
+  key = (key ^ (key >> 15)) * 0xC2B2AE35u;
+  return key >> (32 - bits);
+}
+
+static void index_scalar(const uint64_t *value, uint32_t pc, int n, int bits, uint32_t *index)
+{
+  for (int i = 0; i < n; i++)
+  {
+    index[i] = ((uint32_t)i << bits) | hash_scalar(value[i], pc, bits);
+  }
+}
+
+__attribute__((target("avx2"))) static void index_avx2(const uint64_t *value, uint32_t pc, int n, int bits, uint32_t *index)
+{
+  __m256i pcKey = _mm256_mullo_epi32(_mm256_set1_epi32(pc), _mm256_set1_epi32(0x85EBCA6B));
+  __m128i shift = _mm_cvtsi32_si128(32 - bits);
+  int i = 0;
+  for (; i + 8 <= n; i += 8)
+  {
+    // fold each 64-bit value: low halves xor high halves, in lane order
+    __m256i a = _mm256_loadu_si256((const __m256i *)(value + i));
+    __m256i b = _mm256_loadu_si256((const __m256i *)(value + i + 4));
+    __m256i folded = _mm256_xor_si256(_mm256_shuffle_epi32(a, _MM_SHUFFLE(3, 1, 2, 0)),
+                                      _mm256_shuffle_epi32(a, _MM_SHUFFLE(2, 0, 3, 1)));
+    __m256i foldedHigh = _mm256_xor_si256(_mm256_shuffle_epi32(b, _MM_SHUFFLE(3, 1, 2, 0)),
+                                          _mm256_shuffle_epi32(b, _MM_SHUFFLE(2, 0, 3, 1)));
+    // low 64 bits of each 128-bit lane now hold two folded values: gather them in order
+    __m256i v = _mm256_permute4x64_epi64(_mm256_unpacklo_epi64(folded, foldedHigh), _MM_SHUFFLE(3, 1, 2, 0));
+    __m256i key = _mm256_xor_si256(_mm256_mullo_epi32(v, _mm256_set1_epi32(0x9E3779B9)), pcKey);
+    key = _mm256_mullo_epi32(_mm256_xor_si256(key, _mm256_srli_epi32(key, 15)), _mm256_set1_epi32(0xC2B2AE35));
+    __m256i table = _mm256_slli_epi32(_mm256_add_epi32(_mm256_set1_epi32(i), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7)), bits);
+    _mm256_storeu_si256((__m256i *)(index + i), _mm256_or_si256(table, _mm256_srl_epi32(key, shift)));
+  }
+  for (; i < n; i++)
+  {
+    index[i] = ((uint32_t)i << bits) | hash_scalar(value[i], pc, bits);
+  }
+}
+
+void mpp_index(const uint64_t *value, uint32_t pc, int n, int bits, uint32_t *index)
+{
+  if (current_isa() >= ISA_AVX2)
+    index_avx2(value, pc, n, bits, index);
+  else
+    index_scalar(value, pc, n, bits, index);
+}
@@ -0,0 +1,67 @@
+//========================================================//
+//  mpp.h                                                 //
+//  Header file for the multiperspective perceptron       //
+//                                                        //
+//  Each feature (a view of the branch's context) hashes  //
+//  with the pc into its own small table of weights; the  //
+//  prediction is the sign of the selected weights' sum   //
+//========================================================//
+
+#ifndef MPP_H
+#define MPP_H
+
+#include <stdint.h>
+
+#define MPP_MAX_FEATURES 16
+
+// Weights are 6-bit two's complement, kept in int8_t
+#define MPP_WEIGHT_BITS 6
+#define MPP_WEIGHT_MAX 31
+#define MPP_WEIGHT_MIN -32
+
+// Local histories: 2^MPP_LOCAL_BITS entries of MPP_LOCAL_WIDTH bits
+#define MPP_LOCAL_BITS 8
+#define MPP_LOCAL_WIDTH 16
+
+// Branch targets kept for the path features, each MPP_PATH_WIDTH bits
+#define MPP_PATH_DEPTH 16
+#define MPP_PATH_WIDTH 16
+
+// Call depth register width (saturates at 2^MPP_DEPTH_WIDTH - 1)
+#define MPP_DEPTH_WIDTH 6
+
+// Feature kinds
+#define MPP_BIAS 0   // "b"       the pc alone
+#define MPP_GLOBAL 1 // "g<a>-<b>" global history bits a..b-1 (b <= 64)
+#define MPP_LOCAL 2  // "l<n>"    the n newest bits of the branch's local history
+#define MPP_PATH 3   // "p<n>"    the n most recent taken branch targets
+#define MPP_DEPTH 4  // "d"       call depth (calls minus returns)
+
+struct MppFeature
+{
+  int kind;
+  int first; // g: first history bit; l, p: length
+  int last;  // g: one past the last history bit
+};
+
+// Default feature set: short to long global segments, local histories,
+// paths and the call depth
+constexpr MppFeature MPP_DEFAULT_FEATURES[] = {
+    {MPP_BIAS, 0, 0},     {MPP_GLOBAL, 0, 4},   {MPP_GLOBAL, 0, 8},   {MPP_GLOBAL, 4, 16},
+    {MPP_GLOBAL, 8, 24},  {MPP_GLOBAL, 12, 32}, {MPP_GLOBAL, 16, 40}, {MPP_GLOBAL, 24, 52},
+    {MPP_GLOBAL, 32, 64}, {MPP_LOCAL, 8, 0},    {MPP_LOCAL, 16, 0},   {MPP_PATH, 2, 0},
+    {MPP_PATH, 6, 0},     {MPP_PATH, 12, 0},    {MPP_DEPTH, 0, 0},    {MPP_GLOBAL, 0, 16},
+};
+constexpr int MPP_DEFAULT_COUNT = sizeof(MPP_DEFAULT_FEATURES) / sizeof(MPP_DEFAULT_FEATURES[0]);
+
+// Parse a comma separated feature list ("b,g0-8,l16,p4,d") into
+// 'features'; returns the number of features, -1 if the list is invalid
+//
+int mpp_parse_features(const char *spec, MppFeature *features);
+
+// index[i] = feature i's weight for value[i] at 'pc': a hash of the two
+// in the low 'bits' bits, feature i's table (i << bits) above them
+//
+void mpp_index(const uint64_t *value, uint32_t pc, int n, int bits, uint32_t *index);
+
+#endif
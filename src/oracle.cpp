@@ -0,0 +1,130 @@
+//========================================================//
+//  oracle.cpp                                            //
+//  Source file for the unbounded reference predictors    //
+//                                                        //
+//  Every counter and local history lives in its own      //
+//  hash map entry, so no two branches (or histories) can //
+//  ever share state                                      //
+//========================================================//
+#include <stdio.h>
+#include "predictor.h"
+#include "oracle.h"
+#include "hashmap.h"
+#include "sat_counter.h"
+
+//------------------------------------//
+//       Oracle Configuration         //
+//------------------------------------//
+int oracleMode = 0;
+int oracleHistBits = 0;
+
+//------------------------------------//
+//       Oracle Data Structures       //
+//------------------------------------//
+
+#define ORACLE_BIMODAL 0
+#define ORACLE_GSHARE 1
+#define ORACLE_LOCAL 2
+#define ORACLE_KINDS 3
+
+const char *oracleName[ORACLE_KINDS] = {"bimodal", "gshare", "local"};
+
+FlatMap<uint8_t> *oracleCounters[ORACLE_KINDS]; // 2-bit counters per key
+FlatMap<uint32_t> *oracleLocalHist;             // local history per PC
+uint64_t oracleMispredicts[ORACLE_KINDS];
+uint64_t oracle_ghistory;
+int oracleLocalBits; // local history length, matches the tournament local table
+
+//------------------------------------//
+//         Oracle Functions           //
+//------------------------------------//
+
+void init_oracle()
+{
+  // the gshare oracle sees the same history as the predictor it is compared with
+  if (oracleHistBits <= 0)
+    oracleHistBits = (bpType == TOURNAMENT) ? GlobalPred_Bits : ghistoryBits;
+  if (oracleHistBits > ORACLE_MAX_HIST)
+  {
+    fprintf(stderr, "--oracle: history of %d bits clamped to %d\n", oracleHistBits, ORACLE_MAX_HIST);
+    oracleHistBits = ORACLE_MAX_HIST;
+  }
+  oracleLocalBits = LocalPred_Bits;
+
+  for (int k = 0; k < ORACLE_KINDS; k++)
+  {
+    oracleCounters[k] = new FlatMap<uint8_t>(1 << 16);
+    oracleMispredicts[k] = 0;
+  }
+  oracleLocalHist = new FlatMap<uint32_t>(1 << 12);
+  oracle_ghistory = 0;
+}
+
+// Key of the gshare oracle's counter for 'pc' after global history
+// 'ghist': exact up to 32 bits of history; past that the history goes
+// through a bijective mix, so two (pc, history) pairs share a counter
+// only on a 64-bit collision
+//
+static inline uint64_t oracle_gshare_key(uint32_t pc, uint64_t ghist)
+{
+  if (oracleHistBits <= 32)
+    return ((uint64_t)pc << 32) | ghist;
+  uint64_t h = ghist;
+  h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  h = (h ^ (h >> 27)) * 0x94d049bb133111ebULL;
+  return (h ^ (h >> 31)) ^ pc;
+}
+
+// Predict and train the 2-bit counter for 'key' in oracle 'kind'
+//
+static void oracle_access(int kind, uint64_t key, uint32_t outcome)
+{
+  uint8_t &ctr = oracleCounters[kind]->find_or_insert(key, WN);
+  oracleMispredicts[kind] += SatCounter<2>::predict(ctr) != outcome;
+  ctr = SatCounter<2>::next(ctr, outcome);
+}
+
+void oracle_update(uint32_t pc, uint32_t outcome)
+{
+  uint64_t ghist = oracleHistBits < 64 ? oracle_ghistory & ((1ULL << oracleHistBits) - 1) : oracle_ghistory;
+  uint32_t &lhist = oracleLocalHist->find_or_insert(pc, 0);
+
+  oracle_access(ORACLE_BIMODAL, pc, outcome);
+  oracle_access(ORACLE_GSHARE, oracle_gshare_key(pc, ghist), outcome);
+  oracle_access(ORACLE_LOCAL, ((uint64_t)pc << 32) | lhist, outcome);
+
+  oracle_ghistory = (oracle_ghistory << 1) | outcome;
+  lhist = ((lhist << 1) | outcome) & ((1u << oracleLocalBits) - 1);
+}
+
+void oracle_report(uint64_t num_branches, uint64_t mispredictions)
+{
+  // the oracle each built-in predictor is an aliasing-free version of
+  int counterpart = (bpType == STATIC) ? -1 : ORACLE_GSHARE;
+
+  printf("\nUnbounded oracles (* = counterpart of %s)\n", bpName[bpType]);
+  printf("Storage is unbounded; history is not: gshare keys on the last %d outcomes,\n"
+         "local on the last %d of the branch's own\n", oracleHistBits, oracleLocalBits);
+  printf("%-12s %8s %10s %10s %10s %10s\n",
+         "Oracle", "History", "Entries", "Incorrect", "Rate", "Gap");
+  for (int k = 0; k < ORACLE_KINDS; k++)
+  {
+    int history = (k == ORACLE_GSHARE) ? oracleHistBits : (k == ORACLE_LOCAL) ? oracleLocalBits : 0;
+    int marked = (k == counterpart) || (bpType == TOURNAMENT && k == ORACLE_LOCAL);
+    float rate = 1000 * ((float)oracleMispredicts[k] / (float)num_branches);
+    // how many more mispredictions the real predictor makes than the oracle, per 1000 branches
+    float gap = 1000 * (((float)mispredictions - (float)oracleMispredicts[k]) / (float)num_branches);
+    printf("%-11s%c %8d %10u %10llu %10.3f %10.3f\n",
+           oracleName[k], marked ? '*' : ' ', history, oracleCounters[k]->size(),
+           (unsigned long long)oracleMispredicts[k], rate, gap);
+  }
+}
+
+void cleanup_oracle()
+{
+  for (int k = 0; k < ORACLE_KINDS; k++)
+  {
+    delete oracleCounters[k];
+  }
+  delete oracleLocalHist;
+}
@@ -0,0 +1,41 @@
+//========================================================//
+//  oracle.h                                              //
+//  Header file for the unbounded reference predictors    //
+//                                                        //
+//  Per-PC bimodal, per-(PC, history) gshare and per-PC   //
+//  local-history predictors with no storage limit, used  //
+//  as aliasing-free limits for the real predictors       //
+//========================================================//
+
+#ifndef ORACLE_H
+#define ORACLE_H
+
+#include <stdint.h>
+
+//------------------------------------//
+//       Oracle Configuration         //
+//------------------------------------//
+extern int oracleMode;     // Non-zero when --oracle was given
+extern int oracleHistBits; // Global history length of the gshare oracle (0 = match bpType)
+
+// Longest gshare oracle history; longer requests are clamped with a warning
+#define ORACLE_MAX_HIST 64
+
+//------------------------------------//
+//     Oracle Function Prototypes     //
+//------------------------------------//
+
+void init_oracle();
+
+// Predict and train every oracle with the conditional branch at 'pc'
+//
+void oracle_update(uint32_t pc, uint32_t outcome);
+
+// Print each oracle's mispredictions and the gap between the real
+// predictor ('mispredictions' out of 'num_branches') and the oracle
+//
+void oracle_report(uint64_t num_branches, uint64_t mispredictions);
+
+void cleanup_oracle();
+
+#endif
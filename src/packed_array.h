@@ -0,0 +1,95 @@
+//========================================================//
+//  packed_array.h                                        //
+//  Bit-packed storage for predictor table fields         //
+//                                                        //
+//  Stores 'Width'-bit fields back to back in 64-bit      //
+//  words so a table's host footprint follows its modeled //
+//  bit budget instead of one byte (or more) per entry    //
+//========================================================//
+
+#ifndef PACKED_ARRAY_H
+#define PACKED_ARRAY_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include "sat_counter.h"
+#include "arena.h"
+
+// Fields never straddle two words: a word holds 64 / Width fields and
+// any leftover bits are padding. That is exact for widths dividing 64
+// (1, 2, 4, 8, 16, 32) and within 1/Width of exact otherwise.
+//
+template <unsigned Width>
+class PackedArray
+{
+public:
+  static_assert(Width >= 1 && Width <= 32, "PackedArray field width must be 1..32 bits");
+
+  static const unsigned WIDTH = Width;
+  static const unsigned PER_WORD = 64 / Width;
+  static const uint32_t MAX = (uint32_t)((1ULL << Width) - 1);
+
+  PackedArray() : words(NULL), length(0), fromArena(false) {}
+
+  // Allocate 'entries' fields, all set to 'value', from 'arena' if
+  // given (the arena then owns the memory) or else from malloc
+  void init(uint32_t entries, uint32_t value, Arena *arena = NULL)
+  {
+    length = entries;
+    fromArena = (arena != NULL);
+    words = fromArena ? (uint64_t *)arena->alloc(num_words() * sizeof(uint64_t))
+                      : (uint64_t *)malloc(num_words() * sizeof(uint64_t));
+    uint64_t fill = 0;
+    for (unsigned i = 0; i < PER_WORD; i++)
+      fill |= (uint64_t)(value & MAX) << (i * Width);
+    for (size_t w = 0; w < num_words(); w++)
+      words[w] = fill;
+  }
+
+  void release()
+  {
+    if (!fromArena)
+      free(words);
+    words = NULL;
+    length = 0;
+  }
+
+  uint32_t size() const { return length; }
+
+  // Host memory used by the fields
+  size_t bytes() const { return num_words() * sizeof(uint64_t); }
+
+  uint32_t get(uint32_t i) const
+  {
+    return (uint32_t)(words[i / PER_WORD] >> shift(i)) & MAX;
+  }
+
+  void set(uint32_t i, uint32_t value)
+  {
+    uint64_t &word = words[i / PER_WORD];
+    unsigned s = shift(i);
+    word = (word & ~((uint64_t)MAX << s)) | ((uint64_t)(value & MAX) << s);
+  }
+
+  // Hint that field 'i' is about to be read and written
+  void prefetch(uint32_t i) const
+  {
+    __builtin_prefetch(&words[i / PER_WORD], 1);
+  }
+
+  // Saturating counter update: +1 towards MAX when 'up', else -1 towards 0
+  void update(uint32_t i, uint32_t up)
+  {
+    set(i, SatCounter<Width>::next(get(i), up));
+  }
+
+private:
+  uint64_t *words;
+  uint32_t length;
+  bool fromArena;
+
+  size_t num_words() const { return (length + PER_WORD - 1) / PER_WORD; }
+  static unsigned shift(uint32_t i) { return (i % PER_WORD) * Width; }
+};
+
+#endif
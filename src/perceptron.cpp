@@ -0,0 +1,112 @@
+//========================================================//
+//  perceptron.cpp                                        //
+//  Source file for the perceptron kernels                //
+//                                                        //
+//  Scalar and AVX2 versions, picked by isa.h. Lane i of  //
+//  a row takes input bit i of (history << 1) | 1, so the //
+//  bias is lane 0 with a constant taken input            //
+//========================================================//
+#include <immintrin.h>
+#include "perceptron.h"
+#include "isa.h"
+
+//------------------------------------//
+//           Scalar Kernels           //
+//------------------------------------//
+
+static int output_scalar(const int8_t *w, uint64_t history, int hist)
+{
+  uint64_t x = (history << 1) | 1;
+  int y = 0;
+  for (int i = 0; i <= hist; i++)
+  {
+    y += ((x >> i) & 1) ? w[i] : -w[i];
+  }
+  return y;
+}
+
+static void train_scalar(int8_t *w, uint64_t history, int hist, uint32_t outcome)
+{
+  uint64_t x = (history << 1) | 1;
+  for (int i = 0; i <= hist; i++)
+  {
+    int step = (((x >> i) & 1) == outcome) ? 1 : -1;
+    int weight = w[i] + step;
+    if (weight >= -PERCEPTRON_MAX_WEIGHT && weight <= PERCEPTRON_MAX_WEIGHT)
+    {
+      w[i] = weight;
+    }
+  }
+}
+
+//------------------------------------//
+//            AVX2 Kernels            //
+//------------------------------------//
+
+// Inputs of vector v: +1 / -1 per history bit, 0 past the history
+__attribute__((target("avx2"))) static inline __m256i inputs_avx2(uint64_t x, int v, int hist)
+{
+  __m256i word = _mm256_set1_epi32((uint32_t)(x >> (32 * v)));
+  // byte k of the vector gets byte k / 8 of the word, then keeps its own bit
+  __m256i bytes = _mm256_shuffle_epi8(word, _mm256_setr_epi8(0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1,
+                                                             2, 2, 2, 2, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 3, 3));
+  __m256i bit = _mm256_set1_epi64x(0x8040201008040201ULL);
+  __m256i taken = _mm256_cmpeq_epi8(_mm256_and_si256(bytes, bit), bit);
+  __m256i input = _mm256_sub_epi8(_mm256_and_si256(taken, _mm256_set1_epi8(2)), _mm256_set1_epi8(1));
+
+  __m256i lane = _mm256_add_epi8(_mm256_set1_epi8(32 * v),
+                                 _mm256_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17,
+                                                  18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31));
+  __m256i valid = _mm256_cmpgt_epi8(_mm256_set1_epi8(hist + 1), lane);
+  return _mm256_and_si256(input, valid);
+}
+
+__attribute__((target("avx2"))) static int output_avx2(const int8_t *w, uint64_t history, int hist)
+{
+  uint64_t x = (history << 1) | 1;
+  int vectors = perceptron_row_bytes(hist) / PERCEPTRON_VECTOR;
+  __m256i sum = _mm256_setzero_si256();
+  for (int v = 0; v < vectors; v++)
+  {
+    __m256i weights = _mm256_loadu_si256((const __m256i *)(w + PERCEPTRON_VECTOR * v));
+    __m256i products = _mm256_sign_epi8(weights, inputs_avx2(x, v, hist));
+    // offset the signed products by 128 and add them up 8 at a time with sad
+    sum = _mm256_add_epi64(sum, _mm256_sad_epu8(_mm256_xor_si256(products, _mm256_set1_epi8(-128)),
+                                                _mm256_setzero_si256()));
+  }
+  __m128i half = _mm_add_epi64(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+  int64_t total = _mm_cvtsi128_si64(half) + _mm_extract_epi64(half, 1);
+  return (int)(total - 128 * PERCEPTRON_VECTOR * vectors);
+}
+
+__attribute__((target("avx2"))) static void train_avx2(int8_t *w, uint64_t history, int hist, uint32_t outcome)
+{
+  uint64_t x = (history << 1) | 1;
+  int vectors = perceptron_row_bytes(hist) / PERCEPTRON_VECTOR;
+  for (int v = 0; v < vectors; v++)
+  {
+    __m256i *row = (__m256i *)(w + PERCEPTRON_VECTOR * v);
+    __m256i weights = _mm256_loadu_si256(row);
+    __m256i input = inputs_avx2(x, v, hist);
+    weights = outcome ? _mm256_adds_epi8(weights, input) : _mm256_subs_epi8(weights, input);
+    weights = _mm256_max_epi8(weights, _mm256_set1_epi8(-PERCEPTRON_MAX_WEIGHT)); // adds stops at +127, -128 is one too far
+    _mm256_storeu_si256(row, weights);
+  }
+}
+
+//------------------------------------//
+//         Dispatched Kernels         //
+//------------------------------------//
+
+int perceptron_output(const int8_t *w, uint64_t history, int hist)
+{
+  return current_isa() >= ISA_AVX2 ? output_avx2(w, history, hist) : output_scalar(w, history, hist);
+}
+
+void perceptron_train(int8_t *w, uint64_t history, int hist, uint32_t outcome)
+{
+  if (current_isa() >= ISA_AVX2)
+    train_avx2(w, history, hist, outcome);
+  else
+    train_scalar(w, history, hist, outcome);
+}
@@ -0,0 +1,40 @@
+//========================================================//
+//  perceptron.h                                          //
+//  Header file for the perceptron kernels                //
+//                                                        //
+//  A perceptron is a row of int8 weights: the bias, then //
+//  one weight per global history bit. Rows are padded    //
+//  to whole 32-byte vectors so the dot product and the   //
+//  training step are a few AVX2 instructions per vector  //
+//========================================================//
+
+#ifndef PERCEPTRON_H
+#define PERCEPTRON_H
+
+#include <stdint.h>
+
+// Bytes per weight vector, and the longest history a row can hold
+#define PERCEPTRON_VECTOR 32
+#define PERCEPTRON_MAX_HIST 63
+
+// Weights saturate at +-PERCEPTRON_MAX_WEIGHT (symmetric, so negating one never overflows)
+#define PERCEPTRON_MAX_WEIGHT 127
+
+// Bytes in a row of weights for 'hist' history bits
+//
+static inline int perceptron_row_bytes(int hist)
+{
+  return (hist + PERCEPTRON_VECTOR) / PERCEPTRON_VECTOR * PERCEPTRON_VECTOR;
+}
+
+// Output y = w[0] + sum w[i] * x[i], i = 1..hist, where x[i] is +1 if
+// the i-th newest outcome in 'history' (bit i-1) was taken and -1 if not
+//
+int perceptron_output(const int8_t *w, uint64_t history, int hist);
+
+// Move every weight one step towards agreeing with 'outcome':
+// w[i] += x[i] if taken, w[i] -= x[i] if not (the bias input is +1)
+//
+void perceptron_train(int8_t *w, uint64_t history, int hist, uint32_t outcome);
+
+#endif
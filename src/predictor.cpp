@@ -12,6 +12,16 @@
 #include <cstdint>
 #include <iostream>
 #include <bitset>
+#include "packed_array.h"
+#include "sat_counter.h"
+#include "index_stream.h"
+#include "budget.h"
+#include "isa.h"
+#include "perceptron.h"
+#include "mpp.h"
+#include "loop.h"
+#include "delay_queue.h"
+#include <immintrin.h>
 
 //
 // TODO:Student Information
@@ -25,19 +35,24 @@ const char *email = "pmekkoth@ucsd.edu";
 //------------------------------------//
 
 // Handy Global for use in output routines
-const char *bpName[4] = {"Static", "Gshare",
-                         "Tournament", "Custom"};
+const char *bpName[6] = {"Static", "Gshare",
+                         "Tournament", "Custom", "Perceptron", "Multiperspective"};
 
 // define number of bits required for indexing the BHT here.
-int ghistoryBits = 17; // Number of bits used for Global History
+constexpr int GSHARE_BITS = 17;
+int ghistoryBits = GSHARE_BITS; // Number of bits used for Global History
 int bpType;            // Branch Prediction Type
 int verbose;
 
-//tournament predictor variables (will need to figure out the propper widths for these)
-int LocalHist_Bits=11;
-int LocalPred_Bits=15;
-int GlobalPred_Bits=16;
-int ChooserBits=12;
+//tournament predictor variables (default sizes are checked against the budget at compile time, see below)
+constexpr int LOCAL_HIST_BITS=11;
+constexpr int LOCAL_PRED_BITS=15;
+constexpr int GLOBAL_PRED_BITS=16;
+constexpr int CHOOSER_BITS=12;
+int LocalHist_Bits=LOCAL_HIST_BITS;
+int LocalPred_Bits=LOCAL_PRED_BITS;
+int GlobalPred_Bits=GLOBAL_PRED_BITS;
+int ChooserBits=CHOOSER_BITS;
 
 //current optimal values: (achieves 35 overall mispredict rate)
 //int LocalHist_Bits=11;
@@ -45,13 +60,37 @@ int ChooserBits=12;
 //int GlobalPred_Bits=16;
 //int ChooserBits=12;
 
-//custom predictor variables
-int BimodalBits=13; //need 13 bits for 8192 entries
-int Tage1Bits=13; //need 13 bits for 8192 entries
-int Tage2Bits=12; //need 12 bits for 4096 entries
-int Tage3Bits=11; //need 11 bits for 2048 entries
-int Tage4Bits=10; //need 10 bits for 1024 entries 
-int Tage5Bits=9; //need 9 bits for 512 entries
+//custom predictor variables: TAGE-SC-L (Seznec, CBP 2016): a bimodal base, TAGE_TABLES tagged tables on a
+//geometric series of history lengths, a statistical corrector and a loop predictor (see loop.h)
+constexpr int BIMODAL_BITS=13; //need 13 bits for 8192 entries
+constexpr int TAGE_BITS=10; //every tagged table has 2^10=1024 entries
+constexpr int TAGE_TAG_BITS[TAGE_TABLES+1]={0, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 12, 12}; //longer histories get longer tags
+constexpr int TAGE_MIN_HIST=4; //history length of table 1
+constexpr int TAGE_LONGEST_HIST=640; //history length of table TAGE_TABLES
+constexpr int TAGE_PATH_BITS=16; //path history: one pc bit per conditional branch
+constexpr int TAGE_U_RESET_PERIOD=1 << 18; //the useful counters are halved every 2^18 updates
+constexpr int SC_BITS=10; //every statistical corrector table has 2^10=1024 weights
+constexpr int SC_TABLES=6; //two bias tables, then one per SC_HIST length
+constexpr int SC_HIST[SC_TABLES]={0, 0, 5, 11, 20, 32};
+int BimodalBits=BIMODAL_BITS;
+int TageMinHist=TAGE_MIN_HIST; //set by --custom
+int TageMaxHist=TAGE_LONGEST_HIST;
+
+//perceptron predictor variables: 2^PERCEPTRON_BITS rows of (PERCEPTRON_HIST + 1) 8 bit weights
+constexpr int PERCEPTRON_HIST=63;
+constexpr int PERCEPTRON_BITS=9;
+int PerceptronHist=PERCEPTRON_HIST;
+int PerceptronBits=PERCEPTRON_BITS;
+
+//multiperspective perceptron variables: MppCount features (see mpp.h), each with 2^MppBits weights
+constexpr int MPP_BITS=11;
+int MppBits=MPP_BITS;
+MppFeature MppFeatures[MPP_MAX_FEATURES];
+int MppCount=0; //0 = MPP_DEFAULT_FEATURES
+
+//loop predictor composed over whichever predictor is active (--loop): 2^LoopBits entries
+int LoopMode; //0 = off
+int LoopBits=LOOP_BITS_DEFAULT;
 
 //------------------------------------//
 //      Predictor Data Structures     //
@@ -61,39 +100,296 @@ int Tage5Bits=9; //need 9 bits for 512 entries
 // TODO: Add your own Branch Predictor data structures here
 //
 
+//all tables of the active predictor are carved out of one arena of 2 MB (huge) pages,
+//so random indexes into different tables don't each need their own dTLB entries
+Arena predictorArena;
+
 // gshare
-uint8_t *bht_gshare; //this is the branch history table for gshare (pointer to it)
+PackedArray<2> bht_gshare; //this is the branch history table for gshare (2 bit saturation counter per entry)
 uint64_t ghistory; //this is the global history register for gshare
 
 //tournament predictor: Alpha 21264
-uint16_t *LocalHistTable; //pointer to the local predictor 1 (15 bit wide local history) (2^12 entries)
-uint8_t *LocalPredictTable; //pointer to the local predictor 2 (2 bit saturation counter per entry) (2^15 entries)
-uint8_t *GlobalPredict; //pointer to the global predictor (2 bit saturation counter per entry) (2^15 entries)
-uint8_t *Chooser; //pointer to the chooser predictor (15 bits for 2^15 entries)
+#define LOCAL_HIST_WIDTH 15 //stored local history width, must be >= LocalPred_Bits (only that many bits index the local predictor)
+PackedArray<LOCAL_HIST_WIDTH> LocalHistTable; //local predictor 1 (15 bit wide local history) (2^11 entries)
+PackedArray<2> LocalPredictTable; //local predictor 2 (2 bit saturation counter per entry) (2^15 entries)
+PackedArray<2> GlobalPredict; //global predictor (2 bit saturation counter per entry) (2^16 entries)
+PackedArray<2> Chooser; //chooser predictor (2 bit state per entry) (2^12 entries)
 uint32_t ghistory_tournament; //global history register for tournament predictor (16 bits wide)
 
 
-//custom predictor: Tage branch predictor
-uint8_t *BimodalTable; //pointer to the bimodal predictor (2 bit saturation counter per entry)
+//custom predictor: TAGE-SC-L branch predictor
+PackedArray<2> BimodalTable; //bimodal predictor (2 bit saturation counter per entry), TAGE's base prediction
+
+//the tage tables are stored as separate tag, counter and useful arrays (struct of arrays) rather than
+//one struct per entry, so the tags of all tables can be compared for a branch in a single SIMD compare
+uint16_t *TageTag[TAGE_TABLES+1]; //tag per entry (TAGE_TAG_BITS[t] bits) for tage tables 1 to 12 (entry 0 unused, table 0 is the bimodal)
+PackedArray<3> TageCtr[TAGE_TABLES+1]; //direction counter per entry (3-bit, taken from 4 up)
+PackedArray<2> TageUseful[TAGE_TABLES+1]; //useful counter per entry (2-bit)
+int TageHist[TAGE_TABLES+1]; //history length of each tage table, geometric from TageMinHist to TageMaxHist
+int TageUseAltOnNa; //4 bit counter: from 8 up, a newly allocated provider defers to the alternate prediction
+uint32_t TageTick; //updates since the useful counters were last halved
+uint32_t TageRandom; //xorshift state, spreads allocations over the longer tables
+
+LongHistory ghistory_custom; //this is the global history register for the custom predictor (circular, TAGE_MAX_HIST+ bits)
+uint32_t TagePath; //path history, TAGE_PATH_BITS bits
+uint32_t TagePathMask[TAGE_TABLES+1]; //path bits each table uses: no more than its history length
+int TagePathShift[TAGE_TABLES+1]; //and the right shift completing its rotation
+FoldedHistory TageFold[TAGE_TABLES+1]; //TageHist[t] bits of ghistory_custom folded down to TAGE_BITS for the index
+FoldedHistory TageTagFold[TAGE_TABLES+1]; //to TAGE_TAG_BITS[t] bits for the tag
+FoldedHistory TageTagFold2[TAGE_TABLES+1]; //and to one bit less, so the two folds don't cancel out in the tag
+
+//statistical corrector: 6 bit weights (MPP_WEIGHT_BITS) from bias tables indexed by the pc and TAGE's
+//prediction and GEHL tables on short global histories; their sum overrides TAGE when it is large enough
+int8_t *ScWeights; //the tables back to back, table k's at k << SC_BITS
+int ScThreshold; //training threshold, adapted as the predictor runs
+int ScThresholdCount; //mispredictions minus low confidence correct predictions since it last moved
+
+LoopTable TageLoop; //the loop predictor, LOOP_BITS_DEFAULT
+int TageWithLoop; //7 bit signed counter: a confident loop entry overrides the rest from 0 up
+
+//everything custom_predict() worked out for a branch, reused by train_custom()
+struct CustomLookup
+{
+  uint32_t pc;
+  int valid;
+  uint32_t index[TAGE_TABLES+1]; //index[0] is the bimodal's
+  uint16_t tag[TAGE_TABLES+1];
+  int provider; //longest matching table, 0 = bimodal
+  int alt; //next longest matching table, 0 = bimodal
+  int newEntry; //the provider is weak and not (yet) useful
+  uint8_t providerPred, altPred;
+  uint8_t tagePred; //the provider's prediction, or the alternate's for a new entry when TageUseAltOnNa says so
+  int confidence; //of tagePred: 0 high, 1 medium, 2 low, 3 from the bimodal
+  uint32_t scIndex[SC_TABLES];
+  int scSum;
+  uint8_t scPred; //sign of scSum
+  uint8_t correctedPred; //tagePred, or scPred where the corrector overrides it
+  int loopValid; //the loop predictor has a confident entry
+  uint8_t loopPred;
+  uint8_t prediction; //final
+} CustomLast;
+
+//how the custom predictor's predictions were made, printed by --stats
+struct CustomStats
+{
+  uint64_t provider[TAGE_TABLES+1]; //TAGE predictions by provider table (0 = bimodal)
+  uint64_t providerWrong[TAGE_TABLES+1];
+  uint64_t alt, altWrong; //new provider entries overruled by the alternate prediction
+  uint64_t sc, scWrong; //statistical corrector overrides of TAGE
+  uint64_t loop, loopWrong; //loop predictor overrides
+} CustomCount;
+
+//perceptron predictor
+int8_t *PerceptronWeights; //one row per perceptron, padded to whole vectors (see perceptron.h)
+int PerceptronRow; //bytes per row
+int PerceptronTheta; //training threshold: keep training while |output| <= theta even if correct
+uint64_t ghistory_perceptron; //global history register for the perceptron (PerceptronHist bits used)
+
+//multiperspective perceptron
+int8_t *MppWeights; //the features' weight tables back to back, feature f's at f << MppBits
+uint16_t *MppLocal; //local history table (MPP_LOCAL_WIDTH bits per entry)
+uint16_t MppPath[MPP_PATH_DEPTH]; //low bits of the most recent taken branch targets, newest first
+int MppPathLength; //longest path feature
+uint64_t ghistory_mpp; //global history register for the multiperspective perceptron
+int MppDepth; //call depth
+int MppTheta; //training threshold, adapted as the predictor runs
+int MppThetaCount; //mispredictions minus low confidence correct predictions since theta last moved
+uint32_t MppIndex[MPP_MAX_FEATURES]; //weights selected by the last prediction, reused by its training
+uint32_t MppIndexPC; //pc MppIndex was computed for
+int MppIndexValid; //MppIndex and MppOutput are current
+int MppOutput;
+
+//loop predictor composition (--loop)
+LoopTable LoopOverride; //its own entries, apart from the custom predictor's TageLoop
+int LoopWith; //7 bit signed counter: confident entries override the base predictor from 0 up
+uint32_t LoopLastPC; //branch the last make_prediction() was for
+int LoopLastValid;
+uint8_t LoopBasePred; //the base predictor's prediction for it
+int LoopEntryValid; //and the loop predictor's, when it had a confident entry
+uint8_t LoopEntryPred;
+uint64_t LoopOverrides; //predictions the loop predictor changed
+uint64_t LoopRemoved; //of those, base mispredictions it fixed
+uint64_t LoopAdded; //and correct base predictions it broke
+
+uint64_t lookahead_ghistory; //global history as of the newest branch passed to prefetch_predictor
+
+//delayed update (--delay): each predictor's table update carries the indexes and predictions its
+//lookup used and is applied UpdateDelay conditional branches later, so predictions read tables that
+//lack the updates still in flight. Histories (global, path, local and the loop predictors' iteration
+//counts) are updated at once, as a core updates them at fetch.
+int UpdateDelay= 0;
+struct GshareUpdate{ uint32_t index; uint8_t outcome; };
+struct TournamentUpdate{ uint32_t indexLP2, indexGP, indexChooser; uint8_t localPred, globalPred, outcome; };
+struct CustomUpdate{ CustomLookup l; uint8_t outcome; };
+struct PerceptronUpdate{ int8_t *row; uint64_t history; int output; uint8_t outcome; };
+struct MppUpdate{ uint32_t index[MPP_MAX_FEATURES]; int output; uint8_t outcome; };
+DelayQueue<GshareUpdate> GshareDelay;
+DelayQueue<TournamentUpdate> TournamentDelay;
+DelayQueue<CustomUpdate> CustomDelay;
+DelayQueue<PerceptronUpdate> PerceptronDelay;
+DelayQueue<MppUpdate> MppDelay;
+
+//overriding pair (--override): a fast predictor answers at once and the active (slow) one OverrideLatency
+//cycles later; where they disagree the slow prediction overrides the fast one and the fetch of the cycles
+//in between is thrown away. Each keeps its own tables and histories, and both train on every branch.
+int OverrideType= -1; //the fast predictor, -1 = no override
+int OverrideLatency= 2;
+uint32_t OverrideLastPC; //branch the last make_prediction() was for
+int OverrideLastValid;
+uint8_t OverrideFastPred; //and the fast predictor's prediction for it
+uint64_t OverrideFastWrong; //fast predictor mispredictions
+uint64_t OverrideCount; //slow predictions that overrode the fast one
+uint64_t OverrideFixed; //of those, fast mispredictions corrected
+uint64_t OverrideBroke; //and fast hits turned into mispredictions
+
+//speculative global history (--spec-history): conditional branches shift their predicted direction
+//into the global histories, and each branch checkpoints its position in the history. A mispredicted
+//branch is repaired SpecResolve branches later by flipping its bit where it now sits in every register
+//and fold, which leaves them as restoring the checkpoint, inserting the outcome and replaying the
+//younger branches' bits would, in O(1) per register at any history length or number in flight.
+//The trace holds only the correct path, so at SpecResolve 0 (repair before the next branch is
+//predicted) the history is the true one; above 0 the branches in between, which a core would squash
+//and refetch, are predicted with the wrong bit and stand in for that lost work. Local histories keep
+//the true outcome.
+int SpecHistory= 0;
+int SpecResolve= 0;
+struct SpecCheckpoint{ uint64_t seq; uint8_t wrong; };
+DelayQueue<SpecCheckpoint> SpecInFlight; //the last SpecResolve branches' checkpoints
+uint8_t SpecPrediction; //direction make_prediction() gave the branch about to be trained
+uint64_t SpecSeq; //conditional branches shifted into the history so far
+int SpecWrongInFlight; //mispredicted branches not repaired yet, so wrong bits in the history
+uint64_t SpecRepairs; //histories repaired
+uint64_t SpecExposed; //predictions made with a wrong bit in the history
+uint64_t SpecExposedWrong; //and of those, mispredictions
 
-typedef struct{//this is the tage table entry
 
-  uint16_t tag; //tag for the entry (10 bit)
-  uint8_t saturating_counter; //saturating counter for the entry (2-bit)
-  uint8_t use_counter; //useful counter (1-bit)
 
-} tageEntry;
 
-tageEntry *Tage1Table; //pointer to the tage predictor 1 
-tageEntry *Tage2Table; //pointer to the tage predictor 2 
-tageEntry *Tage3Table; //pointer to the tage predictor 3 
-tageEntry *Tage4Table; //pointer to the tage predictor 4 
-tageEntry *Tage5Table; //pointer to the tage predictor 5 
+//------------------------------------//
+//         Hardware Budgets           //
+//------------------------------------//
+
+//storage of each predictor as init_x() allocates it for the given sizes; table field widths come from
+//the types the tables are stored in, so they can't drift from the code. The default sizes must fit
+//BUDGET_BITS (256 Kbit + 1024 bits) or the build fails; report_budget() prints the runtime sizes.
 
-uint64_t ghistory_custom; //this is the global history register for the custom predictor
+constexpr Budget<2> gshare_budget(int histBits){
+  return {{{"bht_gshare", 1ull << histBits, field_width(bht_gshare)},
+           {"ghistory", 1, (uint32_t)histBits}}}; //only the low histBits bits are ever used
+}
+static_assert(gshare_budget(GSHARE_BITS).fits(), "gshare is over the hardware budget");
+
+constexpr Budget<5> tournament_budget(int localHist, int localPred, int globalPred, int chooser){
+  return {{{"LocalHistTable", 1ull << localHist, field_width(LocalHistTable)},
+           {"LocalPredictTable", 1ull << localPred, field_width(LocalPredictTable)},
+           {"GlobalPredict", 1ull << globalPred, field_width(GlobalPredict)},
+           {"Chooser", 1ull << chooser, field_width(Chooser)},
+           {"ghistory_tournament", 1, (uint32_t)(globalPred > chooser ? globalPred : chooser)}}};
+}
+static_assert(tournament_budget(LOCAL_HIST_BITS, LOCAL_PRED_BITS, GLOBAL_PRED_BITS, CHOOSER_BITS).fits(),
+              "tournament is over the hardware budget");
+
+//tags are stored in uint16_t but only TAGE_TAG_BITS[t] bits wide; besides the tables the custom predictor
+//keeps the longest history, the path and three folded registers per table, and its small counters
+#define CUSTOM_BUDGET_ITEMS (3*TAGE_TABLES+16)
+constexpr Budget<CUSTOM_BUDGET_ITEMS> custom_budget(int bimodalBits, int maxHist){
+  const char *tagName[TAGE_TABLES+1]= {"", "TageTag[1]", "TageTag[2]", "TageTag[3]", "TageTag[4]", "TageTag[5]", "TageTag[6]",
+                                       "TageTag[7]", "TageTag[8]", "TageTag[9]", "TageTag[10]", "TageTag[11]", "TageTag[12]"};
+  const char *ctrName[TAGE_TABLES+1]= {"", "TageCtr[1]", "TageCtr[2]", "TageCtr[3]", "TageCtr[4]", "TageCtr[5]", "TageCtr[6]",
+                                       "TageCtr[7]", "TageCtr[8]", "TageCtr[9]", "TageCtr[10]", "TageCtr[11]", "TageCtr[12]"};
+  const char *usefulName[TAGE_TABLES+1]= {"", "TageUseful[1]", "TageUseful[2]", "TageUseful[3]", "TageUseful[4]", "TageUseful[5]",
+                                          "TageUseful[6]", "TageUseful[7]", "TageUseful[8]", "TageUseful[9]", "TageUseful[10]",
+                                          "TageUseful[11]", "TageUseful[12]"};
+  Budget<CUSTOM_BUDGET_ITEMS> b= {};
+  b.item[0]= {"BimodalTable", 1ull << bimodalBits, field_width(BimodalTable)};
+  uint32_t foldBits= 0;
+  for(int t=1; t<=TAGE_TABLES; t++){
+    b.item[3*t-2]= {tagName[t], 1ull << TAGE_BITS, (uint32_t)TAGE_TAG_BITS[t]};
+    b.item[3*t-1]= {ctrName[t], 1ull << TAGE_BITS, field_width(TageCtr[t])};
+    b.item[3*t]= {usefulName[t], 1ull << TAGE_BITS, field_width(TageUseful[t])};
+    foldBits+= TAGE_BITS + 2 * TAGE_TAG_BITS[t] - 1;
+  }
+  int i= 3*TAGE_TABLES+1;
+  b.item[i++]= {"ScWeights", (uint64_t)SC_TABLES << SC_BITS, MPP_WEIGHT_BITS};
+  Budget<6> loop= loop_budget(LOOP_BITS_DEFAULT);
+  for(int k=0; k<6; k++){
+    b.item[i++]= loop.item[k];
+  }
+  b.item[i++]= {"ghistory_custom", 1, (uint32_t)maxHist};
+  b.item[i++]= {"TagePath", 1, TAGE_PATH_BITS};
+  b.item[i++]= {"TageFold", 1, foldBits};
+  b.item[i++]= {"TageUseAltOnNa", 1, 4};
+  b.item[i++]= {"TageTick", 1, 18};
+  b.item[i++]= {"TageRandom", 1, 32};
+  b.item[i++]= {"ScThreshold", 2, 8};
+  b.item[i++]= {"TageWithLoop", 1, 7};
+  return b;
+}
+static_assert(custom_budget(BIMODAL_BITS, TAGE_LONGEST_HIST).fits(), "custom is over the hardware budget");
 
+//the weights are counted at their (PerceptronHist + 1) x 8 bits, not the padding the simulator keeps
+//after them; the threshold is a constant of the history length, not state
+constexpr Budget<2> perceptron_budget(int hist, int bits){
+  return {{{"PerceptronWeights", (1ull << bits) * (hist + 1), 8 * sizeof(int8_t)},
+           {"ghistory_perceptron", 1, (uint32_t)hist}}};
+}
+static_assert(perceptron_budget(PERCEPTRON_HIST, PERCEPTRON_BITS).fits(), "perceptron is over the hardware budget");
+
+//weights are counted at MPP_WEIGHT_BITS, theta and its counter as one byte each
+constexpr Budget<6> mpp_budget(int bits, int features){
+  return {{{"MppWeights", (uint64_t)features << bits, MPP_WEIGHT_BITS},
+           {"MppLocal", 1ull << MPP_LOCAL_BITS, MPP_LOCAL_WIDTH},
+           {"MppPath", MPP_PATH_DEPTH, MPP_PATH_WIDTH},
+           {"ghistory_mpp", 1, 64},
+           {"MppDepth", 1, MPP_DEPTH_WIDTH},
+           {"MppTheta", 2, 8}}};
+}
+static_assert(mpp_budget(MPP_BITS, MPP_DEFAULT_COUNT).fits(), "multiperspective is over the hardware budget");
 
+//print the budget of predictor 'type' and return its bits
+static uint64_t type_budget(int type)
+{
+  switch (type)
+  {
+  case GSHARE:
+    gshare_budget(ghistoryBits).print(bpName[type]);
+    return gshare_budget(ghistoryBits).bits();
+  case TOURNAMENT:
+    tournament_budget(LocalHist_Bits, LocalPred_Bits, GlobalPred_Bits, ChooserBits).print(bpName[type]);
+    return tournament_budget(LocalHist_Bits, LocalPred_Bits, GlobalPred_Bits, ChooserBits).bits();
+  case CUSTOM:
+    custom_budget(BimodalBits, TageMaxHist).print(bpName[type]);
+    return custom_budget(BimodalBits, TageMaxHist).bits();
+  case PERCEPTRON:
+    perceptron_budget(PerceptronHist, PerceptronBits).print(bpName[type]);
+    return perceptron_budget(PerceptronHist, PerceptronBits).bits();
+  case MULTIPERSPECTIVE:
+    mpp_budget(MppBits, MppCount ? MppCount : MPP_DEFAULT_COUNT).print(bpName[type]);
+    return mpp_budget(MppBits, MppCount ? MppCount : MPP_DEFAULT_COUNT).bits();
+  default:
+    return 0;
+  }
+}
 
+void report_budget()
+{
+  uint64_t bits = type_budget(bpType);
+  if (OverrideType >= 0)
+  {
+    //the fast predictor's tables come on top of the slow one's
+    bits += type_budget(OverrideType);
+    printf("Budget: %s over %s, %llu of %d bits%s\n", bpName[bpType], bpName[OverrideType],
+           (unsigned long long)bits, BUDGET_BITS, bits <= BUDGET_BITS ? "" : " (OVER BUDGET)");
+  }
+  if (LoopMode)
+  {
+    //the loop predictor's entries plus its LoopWith counter come on top of the base predictor
+    bits += loop_budget(LoopBits).bits() + 7;
+    loop_budget(LoopBits).print("Loop");
+    printf("Budget: %s + Loop, %llu of %d bits%s\n", bpName[bpType], (unsigned long long)bits, BUDGET_BITS,
+           bits <= BUDGET_BITS ? "" : " (OVER BUDGET)");
+  }
+}
 
 //------------------------------------//
 //        Predictor Functions         //
@@ -102,17 +398,35 @@ uint64_t ghistory_custom; //this is the global history register for the custom p
 // Initialize the predictor
 //
 
+//arena the tables are allocated from, NULL for separate mallocs (--arena:off)
+static Arena *table_arena(){
+  return arenaMode == ARENA_OFF ? NULL : &predictorArena;
+}
+
+//the direction a branch shifts into the global history: its outcome, or its prediction under --spec-history
+static inline uint8_t history_bit(uint8_t outcome){
+  return SpecHistory ? SpecPrediction : outcome;
+}
+
+//apply the table update 'u' now or, with --delay, queue it and apply the one whose time has come
+template <typename T>
+static inline void delayed_update(DelayQueue<T> &queue, const T &u, void (*apply)(const T &)){
+  T due;
+  if(UpdateDelay == 0){
+    apply(u);
+  }
+  else if(queue.shift(u, &due)){
+    apply(due);
+  }
+}
+
 // gshare functions
 void init_gshare()
 {
   int bht_entries = 1 << ghistoryBits; //this is the number of entries in the BHT, 2^ghistoryBits (ghistoryBits=17, so 2^17=131072 entries)
-  bht_gshare = (uint8_t *)malloc(bht_entries * sizeof(uint8_t)); //allocate memory for the BHT
-  int i = 0;
-  for (i = 0; i < bht_entries; i++) //iterate through the BHT
-  {
-    bht_gshare[i] = WN; //initialize all entries to weakly not taken
-  }
+  bht_gshare.init(bht_entries, WN, table_arena()); //allocate the BHT with all entries weakly not taken
   ghistory = 0; //initialize the ghistory register to 0
+  GshareDelay.init(UpdateDelay);
 }
 
 uint8_t gshare_predict(uint32_t pc)
@@ -122,20 +436,12 @@ uint8_t gshare_predict(uint32_t pc)
   uint32_t pc_lower_bits = pc & (bht_entries - 1); //get the lower bits of the pc
   uint32_t ghistory_lower_bits = ghistory & (bht_entries - 1); //get the lower bits of the glhistory register
   uint32_t index = pc_lower_bits ^ ghistory_lower_bits; //get the index for the BHT by XORing the lower bits of the pc and ghistory
-  switch (bht_gshare[index]) //return the prediction based on the state of the entry in the BHT
-  {
-  case WN:
-    return NOTTAKEN;
-  case SN:
-    return NOTTAKEN;
-  case WT:
-    return TAKEN;
-  case ST:
-    return TAKEN;
-  default:
-    printf("Warning: Undefined state of entry in GSHARE BHT!\n");
-    return NOTTAKEN;
-  }
+  return SatCounter<2>::predict(bht_gshare.get(index)); //WT and ST predict taken, SN and WN not taken
+}
+
+static void gshare_update(const GshareUpdate &u)
+{
+  bht_gshare.update(u.index, u.outcome);
 }
 
 void train_gshare(uint32_t pc, uint8_t outcome)
@@ -146,33 +452,18 @@ void train_gshare(uint32_t pc, uint8_t outcome)
   uint32_t ghistory_lower_bits = ghistory & (bht_entries - 1);//get the lower bits of the glhistory register
   uint32_t index = pc_lower_bits ^ ghistory_lower_bits;//XOR the lower bits of the pc and ghistory
 
-  // Update state of entry in bht based on outcome
-  switch (bht_gshare[index])
-  {
-  case WN:
-    bht_gshare[index] = (outcome == TAKEN) ? WT : SN; //if the outcome is taken, set to weakly taken, else set to strong not taken
-    break;
-  case SN:
-    bht_gshare[index] = (outcome == TAKEN) ? WN : SN; //if the outcome is taken, set to weakly not taken, else set to strong not taken
-    break;
-  case WT:
-    bht_gshare[index] = (outcome == TAKEN) ? ST : WN; //if the outcome is taken, set to strong taken, else set to weakly not taken
-    break;
-  case ST:
-    bht_gshare[index] = (outcome == TAKEN) ? ST : WT; //if the outcome is taken, set to strong taken, else set to weakly taken
-    break;
-  default:
-    printf("Warning: Undefined state of entry in GSHARE BHT!\n");
-    break;
-  }
+  // Update state of entry in bht based on outcome (one step towards the outcome, saturating at SN/ST)
+  delayed_update(GshareDelay, {index, outcome}, gshare_update);
 
   // Update history register
-  ghistory = ((ghistory << 1) | outcome);
+  ghistory = ((ghistory << 1) | history_bit(outcome));
 }
 
 void cleanup_gshare()
 {
-  free(bht_gshare);
+  bht_gshare.release();
+  GshareDelay.release();
+  predictorArena.release();
 }
 
 
@@ -183,647 +474,664 @@ void init_tournament(){
   uint32_t globalPred_entries= 1 << GlobalPred_Bits; //get the number of entries in the global predictor
   uint32_t chooser_entries= 1 << ChooserBits; //get the number of entries in the chooser predictor
 
-  LocalHistTable= (uint16_t*)malloc(localHist_entries*sizeof(uint16_t)); //allocate memory for the local history table
-  LocalPredictTable=(uint8_t*)malloc(localPred_entries*sizeof(uint8_t)); //allocate memory for the local predictor
-  GlobalPredict=(uint8_t*)malloc(globalPred_entries*sizeof(uint8_t)); //allocate memory for the global predictor
-  Chooser=(uint8_t*)malloc(chooser_entries*sizeof(uint8_t)); //allocate memory for the chooser predictor
-  
-  int i=0; 
-  for(i=0;i<localHist_entries;i++){ //iterate through the local history table
-    LocalHistTable[i]= 0; //initialize all entries to weakly not taken
-  }
-  for(i=0;i<localPred_entries;i++){//iterate through the 2nd local predictor
-    LocalPredictTable[i]=WN; //initialize all entries to weakly not taken
-  }
-  int j=0;
-  for(j=0;j<globalPred_entries;j++){//iterate through the global predictor
-    GlobalPredict[j]=WN; //initialize all entries to weakly not taken
-  }
-  for(j=0;j<chooser_entries;j++){//iterate through the chooser predictor
-    Chooser[j]=global_weak; //initialize all entries to choosing the global predictor initially
+  if(LocalPred_Bits > LOCAL_HIST_WIDTH){
+    printf("Warning: LocalPred_Bits is wider than the stored local history (%d bits)!\n", LOCAL_HIST_WIDTH);
   }
+
+  LocalHistTable.init(localHist_entries, 0, table_arena()); //allocate the local history table, all histories empty
+  LocalPredictTable.init(localPred_entries, WN, table_arena()); //allocate the local predictor, all entries weakly not taken
+  GlobalPredict.init(globalPred_entries, WN, table_arena()); //allocate the global predictor, all entries weakly not taken
+  Chooser.init(chooser_entries, global_weak, table_arena()); //allocate the chooser, initially choosing the global predictor
   ghistory_tournament=0; //initialize the global history register to 0
+  TournamentDelay.init(UpdateDelay);
 }
 
 uint8_t tournament_predict(uint32_t pc){
-  uint32_t localHist_entries= 1 << LocalHist_Bits; //get the number of entries in the local history table (10 bits wide or 2^13=8192 entries)
-  uint32_t localPred_entries= 1 << LocalPred_Bits; //get the number of entries in the local predictor table (2 bits wide or 2^13=8192 entries)
-  uint32_t globalPred_entries= 1 << GlobalPred_Bits; //get the number of entries in the global predictor(15 bits wide or 2^15=32768 entries)
-  uint32_t chooser_entries= 1 << ChooserBits; //get the number of entries in the chooser predictor(15 bits wide or 2^15=32768 entries)
+  uint32_t localHist_entries= 1 << LocalHist_Bits; //get the number of entries in the local history table (2^11=2048 entries)
+  uint32_t localPred_entries= 1 << LocalPred_Bits; //get the number of entries in the local predictor table (2^15=32768 entries)
+  uint32_t globalPred_entries= 1 << GlobalPred_Bits; //get the number of entries in the global predictor (2^16=65536 entries)
+  uint32_t chooser_entries= 1 << ChooserBits; //get the number of entries in the chooser predictor (2^12=4096 entries)
  
-  uint32_t pc_lower_bits=pc & (localHist_entries-1); //get the lower bits of the pc (pc_lower_bits is : 0-4095)
-  uint32_t ghistory_lower_bits= ghistory_tournament & (globalPred_entries -1); //get the lower bits of the global history register (globalhistReg_bits is : 0-32767)
-  
+  uint32_t pc_lower_bits=pc & (localHist_entries-1); //get the lower bits of the pc (pc_lower_bits is : 0-2047)
   uint32_t globalhistReg_bits= (ghistory_tournament ^ pc) & (globalPred_entries -1); //gshare based xor operation
  
   int indexLP1=pc_lower_bits ; //get the index for the local history table
-  int indexLP2=LocalHistTable[indexLP1] & (localPred_entries-1); //get the index for the local predictor 2
+  int indexLP2=LocalHistTable.get(indexLP1) & (localPred_entries-1); //get the index for the local predictor 2
   int indexGP= globalhistReg_bits; //get the index for the global predictor
   int indexChooser= ghistory_tournament & (chooser_entries -1); //get the index for the chooser predictor by directly taking the ghr value
-  
-  if(Chooser[indexChooser]==global_strong || Chooser[indexChooser]==global_weak){ //if the chooser index we are pointing to says to choose global, look at global predictor entry
-    switch(GlobalPredict[indexGP]){ //look at the global predictor entry 
-      case SN://if strongly not taken
-        return NOTTAKEN;
-      case WN://if weakly not taken
-        return NOTTAKEN;
-      case WT://if weakly taken
-        return TAKEN;
-      case ST://if strongly taken
-        return TAKEN;
-    }
-  }
-  else if(Chooser[indexChooser] == local_strong || Chooser[indexChooser] == local_weak) { //if the chooser index we are pointing to says to choose local, look at local predictor entry
-    switch(LocalPredictTable[indexLP2]){
-      case SN://if strongly not taken
-        return NOTTAKEN;
-      case WN://if weakly not taken
-        return NOTTAKEN;
-      case WT://if weakly taken
-        return TAKEN;
-      case ST://if strongly taken
-        return TAKEN;
-    }
-  }
-  return NOTTAKEN;
+
+  //both components are read and the chooser picks one (a select, not a branch)
+  uint32_t globalPred= SatCounter<2>::predict(GlobalPredict.get(indexGP));
+  uint32_t localPred= SatCounter<2>::predict(LocalPredictTable.get(indexLP2));
+  return chooser_uses_local(Chooser.get(indexChooser)) ? localPred : globalPred;
+}
+
+//the chooser moves on the predictions the branch was made with; the counters step from their current state
+static void tournament_update(const TournamentUpdate &u){
+  //the chooser only moves when local and global disagree, towards whichever one was right
+  uint32_t disagree= u.localPred ^ u.globalPred;
+  uint32_t globalCorrect= (u.outcome == u.globalPred);
+  Chooser.set(u.indexChooser, ChooserNext[Chooser.get(u.indexChooser)][(disagree << 1) | globalCorrect]);
+
+  //update local predictor and global predictor
+  LocalPredictTable.set(u.indexLP2, SatCounter<2>::next(LocalPredictTable.get(u.indexLP2), u.outcome));
+  GlobalPredict.set(u.indexGP, SatCounter<2>::next(GlobalPredict.get(u.indexGP), u.outcome));
 }
 
 void train_tournament(uint32_t pc, uint8_t outcome){
-  int localHist_entries= 1 << LocalHist_Bits; //get the number of entries in the local history table (10 bits wide or 2^13=8192 entries)
-  int localPred_entries= 1 << LocalPred_Bits; //get the number of entries in the local predictor table (2 bits wide or 2^12=8192 entries)
-  int globalPred_entries= 1 << GlobalPred_Bits; //get the number of entries in the global predictor(15 bits wide or 2^15=32768 entries)
-  int chooser_entries= 1 << ChooserBits; //get the number of entries in the chooser predictor(15 bits wide or 2^15=32768 entries)
+  int localHist_entries= 1 << LocalHist_Bits; //get the number of entries in the local history table (2^11=2048 entries)
+  int localPred_entries= 1 << LocalPred_Bits; //get the number of entries in the local predictor table (2^15=32768 entries)
+  int globalPred_entries= 1 << GlobalPred_Bits; //get the number of entries in the global predictor (2^16=65536 entries)
+  int chooser_entries= 1 << ChooserBits; //get the number of entries in the chooser predictor (2^12=4096 entries)
 
-  uint32_t pc_lower_bits=pc&(localHist_entries-1); //get the lower bits of the pc (pc_lower_bits is : 0-4095)
-  uint32_t ghistory_lower_bits= ghistory_tournament & (globalPred_entries -1); //get the lower bits of the global history register (globalhistReg_bits is : 0-32767)
-  
+  uint32_t pc_lower_bits=pc&(localHist_entries-1); //get the lower bits of the pc (pc_lower_bits is : 0-2047)
   uint32_t globalhistReg_bits=(ghistory_tournament ^ pc) & (globalPred_entries - 1); // Gshare-based XOR operation
-  //ghistory_tournament&(globalPred_entries-1); //get the lower bits of the global history register (globalhistReg_bits is : 0-32767)
   
   int indexLP1=pc_lower_bits ; //get the index for the local predictor 1
-  int indexLP2=LocalHistTable[indexLP1] & (localPred_entries-1); //get the index for the local predictor 2
+  int indexLP2=LocalHistTable.get(indexLP1) & (localPred_entries-1); //get the index for the local predictor 2
   int indexGP= globalhistReg_bits ; //get the index for the global predictor
   int indexChooser=globalhistReg_bits & (chooser_entries-1); //get the index for the chooser predictor
 
-  //if predictions match for local and global return and do nothing
-  int localPred= LocalPredictTable[indexLP2];
-  int globalPred= GlobalPredict[indexGP];
-  
-  
-  switch(GlobalPredict[indexGP]){ //look at the global predictor entry 
-      case SN://if strongly not taken
-        globalPred= NOTTAKEN;
-        break;
-      case WN://if weakly not taken
-        globalPred= NOTTAKEN;
-        break;
-      case WT://if weakly taken
-        globalPred= TAKEN;
-        break;
-      case ST://if strongly taken
-        globalPred= TAKEN;
-        break;
-    }
-    switch(LocalPredictTable[indexLP2]){
-      case SN://if strongly not taken
-        localPred= NOTTAKEN;
-        break;
-      case WN://if weakly not taken
-        localPred= NOTTAKEN;
-        break;
-      case WT://if weakly taken
-        localPred= TAKEN;
-        break;
-      case ST://if strongly taken
-        localPred= TAKEN;
-        break;
-    }
-
-
-  if(localPred != globalPred){
-    switch(Chooser[indexChooser]){
-      case global_strong:
-        Chooser[indexChooser]= (outcome == globalPred) ? global_strong : global_weak;
-        break;
-      case global_weak:
-        Chooser[indexChooser]= (outcome == globalPred) ? global_strong : local_weak;
-        break;
-      case local_weak:
-        Chooser[indexChooser]= (outcome == globalPred) ? global_weak : local_strong;
-        break;
-      case local_strong:
-        Chooser[indexChooser]=(outcome == globalPred) ? local_weak : local_strong;
-        break;
-    }
-  }
-
-  
-  //update local predictor and global predictor
-  if(outcome==TAKEN){
-    if(LocalPredictTable[indexLP2]== ST || LocalPredictTable[indexLP2]== WT){
-      LocalPredictTable[indexLP2]= ST;
-    }
-    else if(LocalPredictTable[indexLP2]== WN){
-      LocalPredictTable[indexLP2]= WT;
-    }
-    else{
-      LocalPredictTable[indexLP2]= WN;
-    }
-  }
-  else if(outcome==NOTTAKEN){
-    if(LocalPredictTable[indexLP2]== SN || LocalPredictTable[indexLP2]== WN){
-      LocalPredictTable[indexLP2]= SN;
-    }
-    else if(LocalPredictTable[indexLP2]== WT){
-      LocalPredictTable[indexLP2]= WN;
-    }
-    else{
-      LocalPredictTable[indexLP2]= WT;
-    }
-  }
-  //update global predictor
-  if(outcome==TAKEN){
-    if(GlobalPredict[indexGP]== ST || GlobalPredict[indexGP]== WT){
-      GlobalPredict[indexGP]= ST;
-    }
-    else if(GlobalPredict[indexGP]== WN){
-      GlobalPredict[indexGP]= WT;
-    }
-    else{
-      GlobalPredict[indexGP]= WN;
-    }
-  }
-  else if(outcome==NOTTAKEN){
-    if(GlobalPredict[indexGP]== SN || GlobalPredict[indexGP]== WN){
-      GlobalPredict[indexGP]= SN;
-    }
-    else if(GlobalPredict[indexGP]== WT){
-      GlobalPredict[indexGP]= WN;
-    }
-    else{
-      GlobalPredict[indexGP]= WT;
-    }
-  }
+  uint8_t localPred= SatCounter<2>::predict(LocalPredictTable.get(indexLP2));
+  uint8_t globalPred= SatCounter<2>::predict(GlobalPredict.get(indexGP));
+  delayed_update(TournamentDelay, {(uint32_t)indexLP2, (uint32_t)indexGP, (uint32_t)indexChooser, localPred, globalPred, outcome},
+                 tournament_update);
 
   //update ghr
-  //printBinary(ghistory_tournament);
-  ghistory_tournament= ((ghistory_tournament <<1) |outcome);////update the global history register by shifting left and adding the outcome
-  //printBinary(ghistory_tournament);
+  ghistory_tournament= ((ghistory_tournament <<1) |history_bit(outcome));////update the global history register by shifting left and adding the outcome
   //update the local history table
-  LocalHistTable[indexLP1]= ((LocalHistTable[indexLP1]<< 1) | outcome);
+  LocalHistTable.set(indexLP1, ((LocalHistTable.get(indexLP1)<< 1) | outcome));
 }
 
 void cleanup_tournament(){
   //free all the data structures for the tournament predictor
-  free(LocalHistTable);
-  free(LocalPredictTable);
-  free(GlobalPredict);
-  free(Chooser); 
+  LocalHistTable.release();
+  LocalPredictTable.release();
+  GlobalPredict.release();
+  Chooser.release();
+  TournamentDelay.release();
+  predictorArena.release();
 }
 
 
-//custom predictor functions:
+//custom predictor functions (TAGE: Seznec & Michaud, JILP 2006; SC and loop predictor: Seznec, CBP 2016)
 void init_custom(){
   int bimodalBits= 1 << BimodalBits; //get the number of entries in the bimodal predictor(2 bits wide or 2^13=8192 entries)
-  int Tage1_bits= 1<< Tage1Bits; //get the number of entries in the tage1 predictor( 2^13=8192 entries)
-  int Tage2_bits= 1<< Tage2Bits; //get the number of entries in the tage2 predictor( 2^12=4096 entries)
-  int Tage3_bits= 1<< Tage3Bits; //get the number of entries in the tage3 predictor( 2^11=2048 entries)
-  int Tage4_bits= 1<< Tage4Bits; //get the number of entries in the tage4 predictor( 2^10=1024 entries)
-  int Tage5_bits= 1<< Tage5Bits; //get the number of entries in the tage5 predictor( 2^9=512 entries)
+  BimodalTable.init(bimodalBits, WN, table_arena()); //allocate the bimodal predictor, all entries weakly not taken
+
+  //history lengths on a geometric series: table t folds TageMinHist * r^(t-1) outcomes into its index
+  //and tag, r chosen so the last table gets TageMaxHist
+  double ratio= pow((double)TageMaxHist / TageMinHist, 1.0 / (TAGE_TABLES - 1));
+  for(int t=1; t<=TAGE_TABLES; t++){
+    TageHist[t]= (int)(TageMinHist * pow(ratio, t - 1) + 0.5);
+    if(t > 1 && TageHist[t] <= TageHist[t-1]){ //short series round to the same length
+      TageHist[t]= TageHist[t-1] + 1;
+    }
+    int entries= 1<< TAGE_BITS;
+    TageTag[t]= table_arena() ? (uint16_t *)predictorArena.alloc(entries * sizeof(uint16_t)) //allocate the tags, all 0
+                              : (uint16_t *)calloc(entries, sizeof(uint16_t));
+    TageCtr[t].init(entries, SatCounter<3>::WEAK_TAKEN - 1, table_arena()); //all counters weakly not taken
+    TageUseful[t].init(entries, 0, table_arena()); //nothing useful yet
+    int pathBits= TageHist[t] < TAGE_PATH_BITS ? TageHist[t] : TAGE_PATH_BITS;
+    TagePathMask[t]= (1u << pathBits) - 1;
+    TagePathShift[t]= pathBits - t % pathBits;
+    TageFold[t].init(TageHist[t], TAGE_BITS);
+    TageTagFold[t].init(TageHist[t], TAGE_TAG_BITS[t]);
+    TageTagFold2[t].init(TageHist[t], TAGE_TAG_BITS[t] - 1);
+  }
+  TageUseAltOnNa= 8;
+  TageTick= 0;
+  TageRandom= 0x2545F491;
+  ghistory_custom.init(TageHist[TAGE_TABLES]+1);//initialize the global history register to 0 (one spare bit for the fold's outgoing bit)
+  TagePath= 0;
+
+  size_t weights= (size_t)SC_TABLES << SC_BITS;
+  ScWeights= table_arena() ? (int8_t *)predictorArena.alloc(weights) //all weights 0
+                           : (int8_t *)calloc(weights, 1);
+  ScThreshold= 35;
+  ScThresholdCount= 0;
+
+  init_loop(TageLoop, LOOP_BITS_DEFAULT, table_arena());
+  TageWithLoop= -1;
+  CustomLast.valid= 0;
+  memset(&CustomCount, 0, sizeof(CustomCount));
+  CustomDelay.init(UpdateDelay);
+}
 
-  BimodalTable= (uint8_t*)malloc(bimodalBits*sizeof(uint8_t)); //allocate memory for the bimodal predictor
-  for(int i=0; i<bimodalBits; i++){ //initialize all entries to weakly not taken
-    BimodalTable[i]=WN;
+//index of tage table 't': the pc hashed with the table's folded history and up to TAGE_PATH_BITS of path
+//(masked rather than taken % 2^TAGE_BITS, which compiled to a 64 bit division)
+static inline uint32_t tage_index(int t, uint32_t pc){
+  uint32_t path= TagePath & TagePathMask[t];
+  path= ((path << t) | (path >> TagePathShift[t])) ^ (path >> TAGE_BITS); //rotate so each table mixes it differently
+  return (pc ^ (pc >> TAGE_BITS) ^ TageFold[t].value ^ path) & ((1<< TAGE_BITS)-1);
+}
+
+//tag of tage table 't': the pc hashed with two folds of the history at different widths
+static inline uint16_t tage_tag(int t, uint32_t pc){
+  return (pc ^ TageTagFold[t].value ^ (TageTagFold2[t].value << 1)) & ((1<< TAGE_TAG_BITS[t])-1);
+}
+
+//bit t of the result is set when tage table t holds tag[t] at index[t]
+static uint32_t tage_match_scalar(const uint16_t *found, const uint16_t *tag){
+  uint32_t matches= 0;
+  for(int t=1; t<=TAGE_TABLES; t++){
+    matches|= (uint32_t)(found[t] == tag[t]) << t;
   }
+  return matches;
+}
+
+//table t sits in 16 bit lane t; lane 0 and the lanes past the last table are masked off the result
+__attribute__((target("avx2,bmi2"))) static uint32_t tage_match_avx2(const uint16_t *found, const uint16_t *tag){
+  uint16_t expected[16]= {};
+  memcpy(expected, tag, (TAGE_TABLES + 1) * sizeof(uint16_t));
+  __m256i foundTags= _mm256_loadu_si256((const __m256i *)found);
+  __m256i expectedTags= _mm256_loadu_si256((const __m256i *)expected);
+  uint32_t bytes= _mm256_movemask_epi8(_mm256_cmpeq_epi16(foundTags, expectedTags)); //2 mask bits per lane
+  return _pext_u32(bytes, 0x55555555) & (((1u << TAGE_TABLES) - 1) << 1);
+}
 
-  Tage1Table= (tageEntry *)malloc(Tage1_bits*sizeof(tageEntry)); //allocate memory for the tage1 predictor (each entry the size of the struct)
-  for(int j=0; j<Tage1_bits; j++){ //initialize all entries in tage table 1
-    Tage1Table[j].saturating_counter=WN;
-    Tage1Table[j].tag=0;
-    Tage1Table[j].use_counter=0;
+uint32_t tage_match_mask(const uint32_t *index, const uint16_t *tag){
+  uint16_t found[16]= {}; //tag stored at each table's index, padded to a whole vector
+  for(int t=1; t<=TAGE_TABLES; t++){
+    found[t]= TageTag[t][index[t]];
   }
-  
-  Tage2Table= (tageEntry *)malloc(Tage2_bits *sizeof(tageEntry)); //allocate memory for the tage2 predictor (each entry the size of the struct)
-  for(int j=0; j<Tage2_bits; j++){ //initialize all entries in tage table 2
-    Tage2Table[j].saturating_counter=WN;
-    Tage2Table[j].tag=0;
-    Tage2Table[j].use_counter=0;
+  return current_isa() >= ISA_AVX2 ? tage_match_avx2(found, tag) : tage_match_scalar(found, tag);
+}
+
+//statistical corrector weights for the branch; the bias tables also see TAGE's prediction and confidence
+static void sc_index(CustomLookup &l){
+  uint32_t mask= (1 << SC_BITS) - 1;
+  l.scIndex[0]= ((l.pc << 1) | l.tagePred) & mask;
+  l.scIndex[1]= (1 << SC_BITS) | (((l.pc << 3) | (l.confidence << 1) | l.tagePred) & mask);
+  for(int k=2; k<SC_TABLES; k++){
+    uint64_t h= ghistory_custom.recent & ((1ull << SC_HIST[k]) - 1);
+    uint64_t key= (h * 0x9E3779B97F4A7C15ull ^ l.pc) * 0xC2B2AE3D27D4EB4Full;
+    l.scIndex[k]= ((uint32_t)k << SC_BITS) | (uint32_t)(key >> (64 - SC_BITS));
   }
-  
-  Tage3Table= (tageEntry *)malloc(Tage3_bits*sizeof(tageEntry)); //allocate memory for the tage3 predictor (each entry the size of the struct)
-  for(int j=0; j<Tage3_bits; j++){ //initialize all entries in tage table 3
-    Tage3Table[j].saturating_counter=WN;
-    Tage3Table[j].tag=0;
-    Tage3Table[j].use_counter=0;
+}
+
+//fill CustomLast for 'pc': the TAGE lookup, then the corrector and the loop predictor on top of it
+static void custom_lookup(uint32_t pc){
+  CustomLookup &l= CustomLast;
+  l.pc= pc;
+  l.valid= 1;
+  l.index[0]= pc & ((1<< BimodalBits)-1); //get the index for the bimodal predictor
+  l.tag[0]= 0;
+  for(int t=1; t<=TAGE_TABLES; t++){
+    l.index[t]= tage_index(t, pc);
+    l.tag[t]= tage_tag(t, pc);
   }
-  
-  Tage4Table= (tageEntry *)malloc(Tage4_bits*sizeof(tageEntry)); //allocate memory for the tage4 predictor (each entry the size of the struct)
-  for(int j=0; j<Tage4_bits; j++){ //initialize all entries in tage table 4
-    Tage4Table[j].saturating_counter=WN;
-    Tage4Table[j].tag=0;
-    Tage4Table[j].use_counter=0;
+
+  //the table with the longest history whose tag matches provides the prediction, the next longest
+  //(or the bimodal) the alternate
+  uint32_t matches= tage_match_mask(l.index, l.tag);
+  l.provider= matches ? 31 - __builtin_clz(matches) : 0;
+  matches&= ~(1u << l.provider);
+  l.alt= matches ? 31 - __builtin_clz(matches) : 0;
+
+  uint32_t bimodal= BimodalTable.get(l.index[0]);
+  l.altPred= l.alt ? SatCounter<3>::predict(TageCtr[l.alt].get(l.index[l.alt])) : SatCounter<2>::predict(bimodal);
+  if(l.provider){
+    uint32_t ctr= TageCtr[l.provider].get(l.index[l.provider]);
+    int weak= ctr == SatCounter<3>::WEAK_TAKEN || ctr == SatCounter<3>::WEAK_TAKEN - 1;
+    l.providerPred= SatCounter<3>::predict(ctr);
+    l.newEntry= weak && TageUseful[l.provider].get(l.index[l.provider]) == 0;
+    l.tagePred= (l.newEntry && TageUseAltOnNa >= 8) ? l.altPred : l.providerPred;
+    l.confidence= (ctr == 0 || ctr == SatCounter<3>::MAX) ? 0 : (weak ? 2 : 1);
   }
-  
-  Tage5Table= (tageEntry *)malloc(Tage5_bits*sizeof(tageEntry)); //allocate memory for the tage5 predictor (each entry the size of the struct)
-  for(int j=0; j<Tage5_bits; j++){ //initialize all entries in tage table 5
-    Tage5Table[j].saturating_counter=WN;
-    Tage5Table[j].tag=0;
-    Tage5Table[j].use_counter=0;
+  else{
+    l.providerPred= l.altPred;
+    l.newEntry= 0;
+    l.tagePred= l.altPred;
+    l.confidence= 3;
   }
 
-  ghistory_custom=0;//initialize the global history register to 0
+  //the corrector overrides TAGE when they disagree and the sum is large: past the threshold against
+  //a high confidence TAGE prediction, a quarter of it otherwise
+  sc_index(l);
+  int sum= 0;
+  for(int k=0; k<SC_TABLES; k++){
+    sum+= 2 * ScWeights[l.scIndex[k]] + 1;
+  }
+  l.scSum= sum;
+  l.scPred= sum >= 0 ? TAKEN : NOTTAKEN;
+  int needed= l.confidence == 0 ? ScThreshold : ScThreshold / 4;
+  l.correctedPred= (l.scPred != l.tagePred && abs(sum) >= needed) ? l.scPred : l.tagePred;
+
+  l.loopValid= loop_predict(TageLoop, pc, &l.loopPred);
+  l.prediction= (l.loopValid && TageWithLoop >= 0) ? l.loopPred : l.correctedPred;
 }
 
 uint8_t custom_predict(uint32_t pc){
-  int bimodal_index= pc & ((1<< BimodalBits)-1); //get the index for the bimodal predictor
-  //uint8_t prediction= NOTTAKEN; //initialize prediction to not taken
-  uint8_t prediction= BimodalTable[bimodal_index]; //get the bimodal prediction
-  
-  //now itterate from table with longest history entries to smallest this way we are able to make sure the 
-  //history is not parter of a larger pattern before looking at smaller patterns (tage5 to tage1)
+  custom_lookup(pc);
+  return CustomLast.prediction;
+}
 
-  int longestMatchTable=0;//this is the table number that has the longest match, if none match, fall back to Bimodalpredictor
-  
-  //start at tage table 5 (history length 13)
-  int tage5_index= (pc ^ (ghistory_custom >> (64- 9))) % (1<< Tage5Bits); //get the index for the tage5 predictor
-  if((Tage5Table[tage5_index].tag== (pc & ((1<< Tage5Bits)-1))) && longestMatchTable==0){ //if the tag matches t
-    longestMatchTable=5;//we found a match in this label
-    prediction= Tage5Table[tage5_index].saturating_counter; //the saturating counter is the prediction
-    //return prediction; //since we found a match in this tage table, no need to teck others
+//on a misprediction, claim an entry in a table with a longer history than the provider's: starting one
+//table up, or two at random, take the first that isn't useful; if all are, age them instead
+static void tage_allocate(const CustomLookup &l, uint8_t outcome){
+  TageRandom^= TageRandom << 13;
+  TageRandom^= TageRandom >> 17;
+  TageRandom^= TageRandom << 5;
+  int first= l.provider + 1 + ((TageRandom & 1) && l.provider + 2 <= TAGE_TABLES);
+  for(int t=first; t<=TAGE_TABLES; t++){
+    if(TageUseful[t].get(l.index[t]) == 0){
+      TageTag[t][l.index[t]]= l.tag[t];
+      TageCtr[t].set(l.index[t], outcome ? SatCounter<3>::WEAK_TAKEN : SatCounter<3>::WEAK_TAKEN - 1);
+      return;
+    }
   }
-
-  //check table 4 (history length 12)
-  int tage4_index= (pc ^ (ghistory_custom >> (64-10))) % (1<< Tage4Bits); //get the index for the tage4 predictor
-  if((Tage4Table[tage4_index].tag== (pc & ((1<< Tage4Bits)-1)))&& longestMatchTable==0){ //if the tag matches
-    longestMatchTable=4;//we found a match in this label
-    prediction= Tage4Table[tage4_index].saturating_counter; //the saturating counter is the prediction
-    //return prediction; //since we found a match in this tage table, no need to teck others
+  for(int t=first; t<=TAGE_TABLES; t++){
+    TageUseful[t].set(l.index[t], SatCounter<2>::dec(TageUseful[t].get(l.index[t])));
   }
+}
 
-  //now check tage 3 table (history length 11)
-  int tage3_index= (pc ^ (ghistory_custom >> (64-11))) % (1<< Tage3Bits); //get the index for the tage3 predictor
-  if((Tage3Table[tage3_index].tag== (pc & ((1<< Tage3Bits)-1))) && longestMatchTable==0){ //if the tag matches
-    longestMatchTable=3;//we found a match in this label
-    prediction= Tage3Table[tage3_index].saturating_counter; //the saturating counter is the prediction
-    //return prediction; //since we found a match in this tage table, no need to teck others
+static void train_tage(const CustomLookup &l, uint8_t outcome){
+  //a new entry's alternate was the better guess: lean towards using it
+  if(l.newEntry && l.providerPred != l.altPred){
+    TageUseAltOnNa= SatCounter<4>::next(TageUseAltOnNa, l.altPred == outcome);
   }
 
-  //check table 2 (history length 10)
-  int tage2_index= (pc ^ (ghistory_custom >> (64-12))) % (1<< Tage2Bits); //get the index for the tage2 predictor
-  if((Tage2Table[tage2_index].tag== (pc & ((1<< Tage2Bits)-1)))&& longestMatchTable==0){ //if the tag matches
-    longestMatchTable=2;//we found a match in this label
-    prediction= Tage2Table[tage2_index].saturating_counter; //the saturating counter is the prediction
-    //return prediction; //since we found a match in this tage table, no need to teck others
+  if(l.tagePred != outcome && l.provider < TAGE_TABLES && !(l.newEntry && l.providerPred == outcome)){
+    tage_allocate(l, outcome);
   }
 
-  //check table 1 (history length 9)
-  int tage1_index= (pc ^ (ghistory_custom >> (64-13))) % (1<< Tage1Bits); //get the index for the tage1 predictor
-  if((Tage1Table[tage1_index].tag== (pc & ((1<< Tage1Bits)-1))) && longestMatchTable==0){ //if the tag matches
-    longestMatchTable=1;//we found a match in this label
-    prediction= Tage1Table[tage1_index].saturating_counter; //the saturating counter is the prediction
-    //return prediction; //since we found a match in this tage table, no need to teck others
+  //periodic useful reset: halve every useful counter so stale entries become replaceable
+  if(++TageTick == TAGE_U_RESET_PERIOD){
+    TageTick= 0;
+    for(int t=1; t<=TAGE_TABLES; t++){
+      for(uint32_t i=0; i<TageUseful[t].size(); i++){
+        TageUseful[t].set(i, TageUseful[t].get(i) >> 1);
+      }
+    }
   }
 
-
-  //return taken or not taken based on the prediction (regardless of match)
-  if(prediction==WN || prediction==SN){
-    return NOTTAKEN;
+  if(l.provider){
+    uint32_t index= l.index[l.provider];
+    TageCtr[l.provider].update(index, outcome);
+    if(TageUseful[l.provider].get(index) == 0){ //not useful yet, so the alternate is still in play
+      if(l.alt){
+        TageCtr[l.alt].update(l.index[l.alt], outcome);
+      }
+      else{
+        BimodalTable.update(l.index[0], outcome);
+      }
+    }
+    if(l.providerPred != l.altPred){ //the provider's entry made (or cost) the difference
+      TageUseful[l.provider].set(index, SatCounter<2>::next(TageUseful[l.provider].get(index), l.providerPred == outcome));
+    }
   }
   else{
-    return TAKEN;
+    BimodalTable.update(l.index[0], outcome);
   }
-  //return prediction; 
 }
 
-void train_custom(uint32_t pc, uint8_t outcome){
-  int bimodal_index= pc & ((1<< BimodalBits)-1); //get the index for the bimodal predictor
-  int longestMatchTable=0;//this is the table number that has the longest match, if none match, fall back to Bimodalpredictor
-
-  //below is a repeat of the code from cutom_predict()
-    //this is because we want to follow the same method to find the tage table with longest matching entry
-    //if non, we fall back on bimodal
-  //start at tage table 5 (history length 13)
-  int tage5_index= (pc ^ (ghistory_custom >> (64- 9))) % (1<<Tage5Bits); //get the index for the tage5 predictor
-  if(Tage5Table[tage5_index].tag== (pc & ((1<< Tage5Bits)-1))){ //if the tag matches t
-    longestMatchTable=5;//we found a match in this label
-  }
-
-  //check table 4 (history length 12)
-  int tage4_index= (pc ^ (ghistory_custom >> (64-10))) % (1<<Tage4Bits); //get the index for the tage4 predictor
-  if((Tage4Table[tage4_index].tag== (pc & ((1<< Tage4Bits)-1))) && longestMatchTable==0){ //if the tag matches/ no previous match
-    longestMatchTable=4;//we found a match in this label
-  }
-
-  //now check tage 3 table (history length 11)
-  int tage3_index= (pc ^ (ghistory_custom >> (64-11))) % (1<<Tage3Bits); //get the index for the tage3 predictor
-  if((Tage3Table[tage3_index].tag== (pc & ((1<< Tage3Bits)-1))) && longestMatchTable==0 ){ //if the tag matches
-    longestMatchTable=3;//we found a match in this label
-  }
-
-  //check table 2 (history length 10)
-  int tage2_index= (pc ^ (ghistory_custom >> (64-12))) % (1<<Tage2Bits); //get the index for the tage2 predictor
-  if((Tage2Table[tage2_index].tag== (pc & ((1<< Tage2Bits)-1))) && longestMatchTable==0){ //if the tag matches
-    longestMatchTable=2;//we found a match in this label
-  }
-
-  //check table 1 (history length 9)
-  int tage1_index= (pc ^ (ghistory_custom >> (64-13))) % (1<<Tage1Bits); //get the index for the tage1 predictor
-  if((Tage1Table[tage1_index].tag== (pc & ((1<< Tage1Bits)-1))) && longestMatchTable==0){ //if the tag matches
-    longestMatchTable=1;//we found a match in this label
-  }
-
-  // Update the bimodal predictor
-  switch (BimodalTable[bimodal_index]) {
-    case WN:
-        BimodalTable[bimodal_index] = (outcome == TAKEN) ? WT : SN;
-        break;
-    case SN:
-        BimodalTable[bimodal_index] = (outcome == TAKEN) ? WN : SN;
-        break;
-    case WT:
-        BimodalTable[bimodal_index] = (outcome == TAKEN) ? ST : WN;
-        break;
-    case ST:
-        BimodalTable[bimodal_index] = (outcome == TAKEN) ? ST : WT;
-        break;
-  }
-
-  //now preform updates depending on if match found in a tage table or not
-  if(longestMatchTable ==0){ //we found no matches
-    //now itterate through table from smallest history length to largest till we find one with an entry with useful counter=0
-    int usefulFound=0;//goes to 1 if we found an entry to fill
-    //start at tage table 1 (history length 9)
-    uint32_t indexT1= (pc ^ (ghistory_custom >> (64-13))) % (1<< Tage1Bits); //get the index for the tage1 predictor
-    if(Tage1Table[indexT1].use_counter==0){
-      //we found an entry with usefullness=0, this means we can replace the entry with a new one based on outcome
-      
-      Tage1Table[indexT1].tag= (pc & ((1<< Tage1Bits)-1)); //set the tag
-      Tage1Table[indexT1].use_counter= 1; //set the usefulness to 1
-
-      if(outcome== TAKEN && Tage1Table[indexT1].saturating_counter==ST){
-        Tage1Table[indexT1].saturating_counter= ST;
+static void train_sc(const CustomLookup &l, uint8_t outcome){
+  int confident= abs(l.scSum) > ScThreshold;
+  if(l.scPred != outcome || !confident){
+    for(int k=0; k<SC_TABLES; k++){
+      int8_t &w= ScWeights[l.scIndex[k]];
+      if(outcome && w < MPP_WEIGHT_MAX){
+        w++;
       }
-      else if(outcome== NOTTAKEN && Tage1Table[indexT1].saturating_counter==ST){
-        Tage1Table[indexT1].saturating_counter= WT;
+      else if(!outcome && w > MPP_WEIGHT_MIN){
+        w--;
       }
-      else if(outcome== TAKEN && Tage1Table[indexT1].saturating_counter==WT){
-        Tage1Table[indexT1].saturating_counter= ST;
-      }
-      else if(outcome== NOTTAKEN && Tage1Table[indexT1].saturating_counter==WT){
-        Tage1Table[indexT1].saturating_counter= WN;
-      }
-      else if(outcome== TAKEN && Tage1Table[indexT1].saturating_counter==WN){
-        Tage1Table[indexT1].saturating_counter= WT;
-      }
-      else if(outcome== NOTTAKEN && Tage1Table[indexT1].saturating_counter==WN){
-        Tage1Table[indexT1].saturating_counter= SN;
-      }
-      else if(outcome== TAKEN && Tage1Table[indexT1].saturating_counter==SN){
-        Tage1Table[indexT1].saturating_counter= WN;
-      }
-      else if(outcome== NOTTAKEN && Tage1Table[indexT1].saturating_counter==SN){
-        Tage1Table[indexT1].saturating_counter= SN;
-      }
-
-      usefulFound=1;
     }
-    
-    //now look at tage table 2 (history length 10)
-    uint32_t indexT2= (pc ^ (ghistory_custom >> (64-12))) % (1<<Tage2Bits); //get the index for the tage2 predictor
-    if((Tage2Table[indexT2].use_counter==0) && usefulFound==0){
-      //we found an entry with usefullness=0, this means we can replace the entry with a new one based on outcome
-      usefulFound=1;
-      Tage2Table[indexT2].tag= (pc & ((1<< Tage2Bits)-1)); //set the tag
-      Tage2Table[indexT2].use_counter= 1; //set the usefulness to 1
-
-      if(outcome== TAKEN && Tage2Table[indexT2].saturating_counter==ST){
-        Tage2Table[indexT2].saturating_counter= ST;
-      }
-      else if(outcome== NOTTAKEN && Tage2Table[indexT2].saturating_counter==ST){
-        Tage2Table[indexT2].saturating_counter= WT;
-      }
-      else if(outcome== TAKEN && Tage2Table[indexT2].saturating_counter==WT){
-        Tage2Table[indexT2].saturating_counter= ST;
-      }
-      else if(outcome== NOTTAKEN && Tage2Table[indexT2].saturating_counter==WT){
-        Tage2Table[indexT2].saturating_counter= WN;
-      }
-      else if(outcome== TAKEN && Tage2Table[indexT2].saturating_counter==WN){
-        Tage2Table[indexT2].saturating_counter= WT;
-      }
-      else if(outcome== NOTTAKEN && Tage2Table[indexT2].saturating_counter==WN){
-        Tage2Table[indexT2].saturating_counter= SN;
-      }
-      else if(outcome== TAKEN && Tage2Table[indexT2].saturating_counter==SN){
-        Tage2Table[indexT2].saturating_counter= WN;
-      }
-      else if(outcome== NOTTAKEN && Tage2Table[indexT2].saturating_counter==SN){
-        Tage2Table[indexT2].saturating_counter= SN;
-      }
+  }
+  //raise the threshold when mispredictions dominate, lower it when low confidence hits do
+  if(l.scPred != outcome){
+    if(++ScThresholdCount >= 32){
+      ScThreshold++;
+      ScThresholdCount= 0;
     }
-    
-    //now look at tage table 3 (history length 11)
-    uint32_t indexT3= (pc ^ (ghistory_custom >> (64-11))) % (1<<Tage3Bits); //get the index for the tage3 predictor
-    if((Tage3Table[indexT3].use_counter==0) && usefulFound==0){
-      //we found an entry with usefullness=0, this means we can replace the entry with a new one based on outcome
-      usefulFound=1;
-      Tage3Table[indexT3].tag= (pc & ((1<< Tage3Bits)-1)); //set the tag
-      Tage3Table[indexT3].use_counter= 1; //set the usefulness to 1
-
-      if(outcome== TAKEN && Tage3Table[indexT3].saturating_counter==ST){
-        Tage3Table[indexT3].saturating_counter= ST;
-      }
-      else if(outcome== NOTTAKEN && Tage3Table[indexT3].saturating_counter==ST){
-        Tage3Table[indexT3].saturating_counter= WT;
-      }
-      else if(outcome== TAKEN && Tage3Table[indexT3].saturating_counter==WT){
-        Tage3Table[indexT3].saturating_counter= ST;
-      }
-      else if(outcome== NOTTAKEN && Tage3Table[indexT3].saturating_counter==WT){
-        Tage3Table[indexT3].saturating_counter= WN;
-      }
-      else if(outcome== TAKEN && Tage3Table[indexT3].saturating_counter==WN){
-        Tage3Table[indexT3].saturating_counter= WT;
-      }
-      else if(outcome== NOTTAKEN && Tage3Table[indexT3].saturating_counter==WN){
-        Tage3Table[indexT3].saturating_counter= SN;
-      }
-      else if(outcome== TAKEN && Tage3Table[indexT3].saturating_counter==SN){
-        Tage3Table[indexT3].saturating_counter= WN;
-      }
-      else if(outcome== NOTTAKEN && Tage3Table[indexT3].saturating_counter==SN){
-        Tage3Table[indexT3].saturating_counter= SN;
-      }
+  }
+  else if(!confident){
+    if(--ScThresholdCount <= -32){
+      ScThreshold--;
+      ScThresholdCount= 0;
     }
+  }
+}
 
-    //now look at tage table 4 (history length 12)
-    uint32_t indexT4= (pc ^ (ghistory_custom >> (64-10))) % (1<<Tage4Bits); //get the index for the tage4 predictor
-    if((Tage4Table[indexT4].use_counter==0) && usefulFound==0){
-      //we found an entry with usefullness=0, this means we can replace the entry with a new one based on outcome
-      usefulFound=1;
-      Tage4Table[indexT4].tag= (pc & ((1<< Tage4Bits)-1)); //set the tag
-      Tage4Table[indexT4].use_counter= 1; //set the usefulness to 1
+static void custom_update(const CustomUpdate &u){
+  train_sc(u.l, u.outcome);
+  train_tage(u.l, u.outcome);
+}
 
-      if(outcome== TAKEN && Tage4Table[indexT4].saturating_counter==ST){
-        Tage4Table[indexT4].saturating_counter= ST;
-      }
-      else if(outcome== NOTTAKEN && Tage4Table[indexT4].saturating_counter==ST){
-        Tage4Table[indexT4].saturating_counter= WT;
-      }
-      else if(outcome== TAKEN && Tage4Table[indexT4].saturating_counter==WT){
-        Tage4Table[indexT4].saturating_counter= ST;
-      }
-      else if(outcome== NOTTAKEN && Tage4Table[indexT4].saturating_counter==WT){
-        Tage4Table[indexT4].saturating_counter= WN;
-      }
-      else if(outcome== TAKEN && Tage4Table[indexT4].saturating_counter==WN){
-        Tage4Table[indexT4].saturating_counter= WT;
-      }
-      else if(outcome== NOTTAKEN && Tage4Table[indexT4].saturating_counter==WN){
-        Tage4Table[indexT4].saturating_counter= SN;
-      }
-      else if(outcome== TAKEN && Tage4Table[indexT4].saturating_counter==SN){
-        Tage4Table[indexT4].saturating_counter= WN;
-      }
-      else if(outcome== NOTTAKEN && Tage4Table[indexT4].saturating_counter==SN){
-        Tage4Table[indexT4].saturating_counter= SN;
-      }
+void train_custom(uint32_t pc, uint8_t outcome){
+  if(!(CustomLast.valid && CustomLast.pc == pc)){ //make_prediction normally just looked it up
+    custom_lookup(pc);
+  }
+  const CustomLookup &l= CustomLast;
+  CustomLast.valid= 0;
+
+  //statistics
+  int wrong= l.prediction != outcome;
+  if(l.loopValid && TageWithLoop >= 0 && l.loopPred != l.correctedPred){
+    CustomCount.loop++;
+    CustomCount.loopWrong+= wrong;
+  }
+  else if(l.correctedPred != l.tagePred){
+    CustomCount.sc++;
+    CustomCount.scWrong+= wrong;
+  }
+  else if(l.tagePred != l.providerPred){
+    CustomCount.alt++;
+    CustomCount.altWrong+= wrong;
+  }
+  else{
+    CustomCount.provider[l.provider]++;
+    CustomCount.providerWrong[l.provider]+= wrong;
+  }
+
+  //the loop predictor backs up TAGE and the corrector; it only overrides them once it has beaten them
+  if(l.loopValid && l.loopPred != l.correctedPred){
+    TageWithLoop+= (l.loopPred == outcome) ? (TageWithLoop < 63) : -(TageWithLoop > -64);
+  }
+  train_loop(TageLoop, pc, outcome, l.correctedPred);
+  delayed_update(CustomDelay, {l, outcome}, custom_update);
+
+  //end by updating the histories based on the outcome
+  uint8_t bit= history_bit(outcome);
+  ghistory_custom.push(bit);//update the global history register
+  TagePath= ((TagePath << 1) | ((pc ^ (pc >> 2)) & 1)) & ((1u << TAGE_PATH_BITS) - 1);
+  for(int t=1; t<=TAGE_TABLES; t++){
+    uint32_t out= ghistory_custom.bit(TageHist[t]); //the three folds share the bit leaving the window
+    TageFold[t].update(bit, out); //O(1) per table whatever its history length
+    TageTagFold[t].update(bit, out);
+    TageTagFold2[t].update(bit, out);
+  }
+}
+
+static void report_custom_stats(){
+  uint64_t total= CustomCount.alt + CustomCount.sc + CustomCount.loop;
+  for(int t=0; t<=TAGE_TABLES; t++){
+    total+= CustomCount.provider[t];
+  }
+  printf("Provider statistics: %llu predictions\n", (unsigned long long)total);
+  printf("  %-14s %12s %6s %12s %9s\n", "source", "predictions", "%", "mispredicts", "wrong %");
+  for(int t=0; t<=TAGE_TABLES+3; t++){
+    char name[32];
+    uint64_t count, wrong;
+    if(t <= TAGE_TABLES){
+      snprintf(name, sizeof(name), t ? "tage[%d] (%d)" : "bimodal", t, TageHist[t]);
+      count= CustomCount.provider[t];
+      wrong= CustomCount.providerWrong[t];
     }
-  
-    //now look at tage table 5 (history length 13)
-    uint32_t indexT5= (pc ^ (ghistory_custom >> (64-9))) % (1<<Tage5Bits); //get the index for the tage5 predictor
-    if((Tage5Table[indexT5].use_counter==0) && usefulFound==0){
-      //we found an entry with usefullness=0, this means we can replace the entry with a new one based on outcome
-      usefulFound=1;
-      Tage5Table[indexT5].tag= (pc & ((1<< Tage5Bits)-1)); //set the tag
-      Tage5Table[indexT5].use_counter= 1; //set the usefulness to 1
-
-      if(outcome== TAKEN && Tage5Table[indexT5].saturating_counter==ST){
-        Tage5Table[indexT5].saturating_counter= ST;
-      }
-      else if(outcome== NOTTAKEN && Tage5Table[indexT5].saturating_counter==ST){
-        Tage5Table[indexT5].saturating_counter= WT;
-      }
-      else if(outcome== TAKEN && Tage5Table[indexT5].saturating_counter==WT){
-        Tage5Table[indexT5].saturating_counter= ST;
-      }
-      else if(outcome== NOTTAKEN && Tage5Table[indexT5].saturating_counter==WT){
-        Tage5Table[indexT5].saturating_counter= WN;
-      }
-      else if(outcome== TAKEN && Tage5Table[indexT5].saturating_counter==WN){
-        Tage5Table[indexT5].saturating_counter= WT;
-      }
-      else if(outcome== NOTTAKEN && Tage5Table[indexT5].saturating_counter==WN){
-        Tage5Table[indexT5].saturating_counter= SN;
-      }
-      else if(outcome== TAKEN && Tage5Table[indexT5].saturating_counter==SN){
-        Tage5Table[indexT5].saturating_counter= WN;
-      }
-      else if(outcome== NOTTAKEN && Tage5Table[indexT5].saturating_counter==SN){
-        Tage5Table[indexT5].saturating_counter= SN;
-      }
+    else if(t == TAGE_TABLES+1){
+      snprintf(name, sizeof(name), "alt on new");
+      count= CustomCount.alt;
+      wrong= CustomCount.altWrong;
     }
+    else if(t == TAGE_TABLES+2){
+      snprintf(name, sizeof(name), "sc override");
+      count= CustomCount.sc;
+      wrong= CustomCount.scWrong;
+    }
+    else{
+      snprintf(name, sizeof(name), "loop override");
+      count= CustomCount.loop;
+      wrong= CustomCount.loopWrong;
+    }
+    printf("  %-14s %12llu %6.2f %12llu %9.2f\n", name, (unsigned long long)count,
+           total ? 100.0 * count / total : 0.0, (unsigned long long)wrong, count ? 100.0 * wrong / count : 0.0);
   }
-  else{ //there is a match in one of the tage tables
-    uint32_t indexMatch;
-    switch(longestMatchTable){
-      case 1:
-        indexMatch=tage1_index;
-        break;
-      case 2:
-        indexMatch=tage2_index;
-        break;
-      case 3:
-        indexMatch=tage3_index;
-        break;
-      case 4:
-        indexMatch=tage4_index;
-        break;
-      case 5:
-        indexMatch=tage5_index;
-        break;
+}
+
+void cleanup_custom(){
+  BimodalTable.release();
+  for(int t=1; t<=TAGE_TABLES; t++){
+    if(!table_arena()){
+      free(TageTag[t]);
     }
-    if(outcome== TAKEN){
-      switch(longestMatchTable){
-        case 1:
-          if(Tage1Table[indexMatch].saturating_counter <ST){
-            Tage1Table[indexMatch].saturating_counter ++;
-          }
-          break;
-        case 2:
-          if(Tage2Table[indexMatch].saturating_counter <ST){
-            Tage2Table[indexMatch].saturating_counter ++;
-          }
-          break;
-        case 3:
-          if(Tage3Table[indexMatch].saturating_counter <ST){
-            Tage3Table[indexMatch].saturating_counter ++;
-          }
-          break;
-        case 4:
-          if(Tage4Table[indexMatch].saturating_counter <ST){
-            Tage4Table[indexMatch].saturating_counter ++;
-          }
-          break;
-        case 5:
-          if(Tage5Table[indexMatch].saturating_counter <ST){
-            Tage5Table[indexMatch].saturating_counter ++;
-          }
-          break;
+    TageCtr[t].release();
+    TageUseful[t].release();
+  }
+  if(!table_arena()){
+    free(ScWeights);
+  }
+  ScWeights= NULL;
+  cleanup_loop(TageLoop);
+  CustomDelay.release();
+  ghistory_custom.release();
+  predictorArena.release();
+}
 
-      }
+
+//perceptron predictor functions (Jimenez & Lin, HPCA 2001): the weights live in perceptron.cpp's
+//vector layout, one row per perceptron, picked by the low pc bits
+void init_perceptron(){
+  uint32_t rows= 1 << PerceptronBits; //get the number of perceptrons
+  PerceptronRow= perceptron_row_bytes(PerceptronHist);
+  size_t bytes= (size_t)rows * PerceptronRow;
+  PerceptronWeights= table_arena() ? (int8_t *)predictorArena.alloc(bytes) //all weights 0
+                                   : (int8_t *)calloc(bytes, 1);
+  PerceptronTheta= (int)(1.93 * PerceptronHist + 14); //the paper's best threshold for a history length
+  ghistory_perceptron= 0;
+  PerceptronDelay.init(UpdateDelay);
+}
+
+static inline int8_t *perceptron_row(uint32_t pc){
+  return PerceptronWeights + (size_t)(pc & ((1 << PerceptronBits) - 1)) * PerceptronRow;
+}
+
+uint8_t perceptron_predict(uint32_t pc){
+  return perceptron_output(perceptron_row(pc), ghistory_perceptron, PerceptronHist) >= 0 ? TAKEN : NOTTAKEN;
+}
+
+static void perceptron_apply(const PerceptronUpdate &u){
+  uint8_t prediction= u.output >= 0 ? TAKEN : NOTTAKEN;
+  if(prediction != u.outcome || abs(u.output) <= PerceptronTheta){ //wrong, or right but not confidently
+    perceptron_train(u.row, u.history, PerceptronHist, u.outcome);
+  }
+}
+
+//train with the output already computed for this branch
+static inline void perceptron_update(int8_t *row, int output, uint8_t outcome){
+  delayed_update(PerceptronDelay, {row, ghistory_perceptron, output, outcome}, perceptron_apply);
+  ghistory_perceptron= (ghistory_perceptron << 1) | history_bit(outcome);
+}
+
+void train_perceptron(uint32_t pc, uint8_t outcome){
+  int8_t *row= perceptron_row(pc);
+  perceptron_update(row, perceptron_output(row, ghistory_perceptron, PerceptronHist), outcome);
+}
+
+void cleanup_perceptron(){
+  if(!table_arena()){
+    free(PerceptronWeights);
+  }
+  PerceptronWeights= NULL;
+  PerceptronDelay.release();
+  predictorArena.release();
+}
+
+
+//multiperspective perceptron functions (Jimenez, CBP 2016, hashed perceptron side only): every feature
+//hashes its view of the context with the pc into its own table, and the prediction is the sign of
+//the selected weights' sum. Weights w count as 2w+1 so none is ever neutral, and the training
+//threshold adapts as in O-GEHL.
+void init_mpp(){
+  if(MppCount == 0){ //no --mpp feature list, use the defaults
+    for(int f=0; f<MPP_DEFAULT_COUNT; f++){
+      MppFeatures[f]= MPP_DEFAULT_FEATURES[f];
     }
-    else{ //the outcome is not taken
-      switch(longestMatchTable){
-        case 1:
-          if(Tage1Table[indexMatch].saturating_counter <SN){
-            Tage1Table[indexMatch].saturating_counter --;
-          }
-          break;
-        case 2:
-          if(Tage2Table[indexMatch].saturating_counter <SN){
-            Tage2Table[indexMatch].saturating_counter --;
-          }
-          break;
-        case 3:
-          if(Tage3Table[indexMatch].saturating_counter <SN){
-            Tage3Table[indexMatch].saturating_counter --;
-          }
-          break;
-        case 4:
-          if(Tage4Table[indexMatch].saturating_counter <SN){
-            Tage4Table[indexMatch].saturating_counter --;
-          }
-          break;
-        case 5:
-          if(Tage5Table[indexMatch].saturating_counter <SN){
-            Tage5Table[indexMatch].saturating_counter --;
-          }
-          break;
+    MppCount= MPP_DEFAULT_COUNT;
+  }
+  MppPathLength= 0;
+  for(int f=0; f<MppCount; f++){
+    if(MppFeatures[f].kind == MPP_PATH && MppFeatures[f].first > MppPathLength){
+      MppPathLength= MppFeatures[f].first;
+    }
+  }
+  size_t weights= (size_t)MppCount << MppBits;
+  MppWeights= table_arena() ? (int8_t *)predictorArena.alloc(weights) //all weights 0
+                            : (int8_t *)calloc(weights, 1);
+  MppLocal= table_arena() ? (uint16_t *)predictorArena.alloc(sizeof(uint16_t) << MPP_LOCAL_BITS)
+                          : (uint16_t *)calloc(1 << MPP_LOCAL_BITS, sizeof(uint16_t));
+  memset(MppPath, 0, sizeof(MppPath));
+  ghistory_mpp= 0;
+  MppDepth= 0;
+  MppTheta= 2 * MppCount + 14;
+  MppThetaCount= 0;
+  MppIndexValid= 0;
+  MppDelay.init(UpdateDelay);
+}
+
+//the feature's view of the current context; path[n] is the hash of the n newest targets
+static uint64_t mpp_feature_value(const MppFeature &f, uint32_t pc, const uint64_t *path){
+  switch(f.kind){
+  case MPP_GLOBAL:{
+    int length= f.last - f.first;
+    uint64_t segment= ghistory_mpp >> f.first;
+    return length == 64 ? segment : segment & ((1ull << length) - 1);
+  }
+  case MPP_LOCAL:
+    return MppLocal[pc & ((1 << MPP_LOCAL_BITS) - 1)] & ((1u << f.first) - 1);
+  case MPP_PATH:
+    return path[f.first];
+  case MPP_DEPTH:
+    return MppDepth;
+  default: //MPP_BIAS
+    return 0;
+  }
+}
+
+//fill MppIndex for 'pc' and return the perceptron output
+static int mpp_lookup(uint32_t pc){
+  uint64_t path[MPP_PATH_DEPTH+1]; //every path feature's hash, each extending the one before
+  path[0]= 0;
+  for(int i=0; i<MppPathLength; i++){
+    path[i+1]= ((path[i] << 5) | (path[i] >> 59)) ^ MppPath[i]; //rotate so each target lands on different bits
+  }
+  uint64_t value[MPP_MAX_FEATURES];
+  for(int f=0; f<MppCount; f++){
+    value[f]= mpp_feature_value(MppFeatures[f], pc, path);
+  }
+  mpp_index(value, pc, MppCount, MppBits, MppIndex); //hash all the features at once
+  //a plain loop: 16 scattered bytes load faster one at a time than with an AVX2 or AVX-512 gather
+  int sum= 0;
+  for(int f=0; f<MppCount; f++){
+    sum+= MppWeights[MppIndex[f]];
+  }
+  MppIndexPC= pc;
+  MppIndexValid= 1;
+  MppOutput= 2 * sum + MppCount;
+  return MppOutput;
+}
+
+uint8_t mpp_predict(uint32_t pc){
+  return mpp_lookup(pc) >= 0 ? TAKEN : NOTTAKEN;
+}
 
+static void mpp_update(const MppUpdate &u){
+  uint8_t prediction= u.output >= 0 ? TAKEN : NOTTAKEN;
+  int confident= abs(u.output) > MppTheta;
+  if(prediction != u.outcome || !confident){
+    for(int f=0; f<MppCount; f++){
+      int8_t &w= MppWeights[u.index[f]];
+      if(u.outcome && w < MPP_WEIGHT_MAX){
+        w++;
       }
-      
+      else if(!u.outcome && w > MPP_WEIGHT_MIN){
+        w--;
+      }
+    }
+  }
+  //raise theta when mispredictions dominate, lower it when low confidence hits do
+  if(prediction != u.outcome){
+    if(++MppThetaCount >= 64){
+      MppTheta++;
+      MppThetaCount= 0;
     }
+  }
+  else if(!confident){
+    if(--MppThetaCount <= -64){
+      MppTheta--;
+      MppThetaCount= 0;
+    }
+  }
+}
+
+//every record goes through here: conditional branches train the weights and histories,
+//calls and returns move the depth and taken branches push their target onto the path
+void train_mpp(uint32_t pc, uint32_t target, uint8_t outcome, uint32_t condition, uint32_t call, uint32_t ret){
+  if(condition){
+    int output= (MppIndexValid && MppIndexPC == pc) ? MppOutput : mpp_lookup(pc); //make_prediction just looked it up
+    MppIndexValid= 0;
+    MppUpdate u;
+    memcpy(u.index, MppIndex, sizeof(uint32_t) * MppCount);
+    u.output= output;
+    u.outcome= outcome;
+    delayed_update(MppDelay, u, mpp_update);
+
+    uint16_t &local= MppLocal[pc & ((1 << MPP_LOCAL_BITS) - 1)];
+    local= (local << 1) | outcome;
+    ghistory_mpp= (ghistory_mpp << 1) | history_bit(outcome);
+  }
+  if(call && MppDepth < (1 << MPP_DEPTH_WIDTH) - 1){
+    MppDepth++;
+  }
+  if(ret && MppDepth > 0){
+    MppDepth--;
+  }
+  if(outcome || !condition){ //taken
+    memmove(MppPath + 1, MppPath, sizeof(MppPath) - sizeof(MppPath[0]));
+    MppPath[0]= (uint16_t)(target >> 2);
+  }
+}
 
-  //end by updating the ghr based on the outcome. (No changes ever made to PC)
-    ghistory_custom= ((ghistory_custom <<1) | outcome);//update the global history register
+void cleanup_mpp(){
+  if(!table_arena()){
+    free(MppWeights);
+    free(MppLocal);
   }
+  MppWeights= NULL;
+  MppLocal= NULL;
+  MppDelay.release();
+  predictorArena.release();
 }
 
-void cleanup_custom(){
-  free(BimodalTable);
-  free(Tage1Table);
-  free(Tage2Table);
-  free(Tage3Table);
-  free(Tage4Table);
-  free(Tage5Table);
-  //free(PartialTag);
+
+//loop predictor composition: the base predictor predicts and trains exactly as it would alone, and
+//a confident loop entry replaces its prediction once the loop predictor has beaten it more often than not
+static uint32_t loop_compose(uint32_t pc, uint32_t basePrediction){
+  LoopLastPC= pc;
+  LoopLastValid= 1;
+  LoopBasePred= basePrediction;
+  LoopEntryValid= loop_predict(LoopOverride, pc, &LoopEntryPred);
+  return (LoopEntryValid && LoopWith >= 0) ? LoopEntryPred : basePrediction;
+}
+
+static void train_loop_override(uint32_t pc, uint8_t outcome){
+  uint8_t prediction= (LoopEntryValid && LoopWith >= 0) ? LoopEntryPred : LoopBasePred;
+  if(prediction != LoopBasePred){
+    LoopOverrides++;
+    LoopRemoved+= prediction == outcome;
+    LoopAdded+= prediction != outcome;
+  }
+  if(LoopEntryValid && LoopEntryPred != LoopBasePred){
+    LoopWith+= (LoopEntryPred == outcome) ? (LoopWith < 63) : -(LoopWith > -64);
+  }
+  train_loop(LoopOverride, pc, outcome, LoopBasePred);
+  LoopLastValid= 0;
 }
 
+void report_loop_override(uint64_t branches){
+  int64_t net= (int64_t)LoopRemoved - (int64_t)LoopAdded;
+  printf("\nLoop predictor: %d entries over %s\n", 1 << LoopBits, bpName[bpType]);
+  printf("  overrides:     %10llu\n", (unsigned long long)LoopOverrides);
+  printf("  removed:       %10llu  base mispredictions\n", (unsigned long long)LoopRemoved);
+  printf("  added:         %10llu  base hits turned into mispredictions\n", (unsigned long long)LoopAdded);
+  printf("  net removed:   %10lld  (%.3f per 1000 branches)\n", (long long)net,
+         1000.0 * net / (branches ? branches : 1));
+}
 
-void init_predictor()
+
+static void init_type(int type)
 {
-  switch (bpType)
+  switch (type)
   {
   case STATIC:
     break;
@@ -836,21 +1144,365 @@ void init_predictor()
   case CUSTOM:
     init_custom();
     break;
+  case PERCEPTRON:
+    init_perceptron();
+    break;
+  case MULTIPERSPECTIVE:
+    init_mpp();
+    break;
   default:
     break;
   }
 }
 
-// Make a prediction for conditional branch instruction at PC 'pc'
-// Returning TAKEN indicates a prediction of taken; returning NOTTAKEN
-// indicates a prediction of not taken
-//
-uint32_t make_prediction(uint32_t pc, uint32_t target, uint32_t direct)
+void init_predictor()
+{
+  lookahead_ghistory = 0;
+  init_type(bpType);
+  if (OverrideType >= 0)
+  {
+    init_type(OverrideType);
+    OverrideLastValid = 0;
+    OverrideFastWrong = 0;
+    OverrideCount = 0;
+    OverrideFixed = 0;
+    OverrideBroke = 0;
+  }
+  if (SpecHistory)
+  {
+    SpecInFlight.init(SpecResolve);
+    SpecSeq = 0;
+    SpecWrongInFlight = 0;
+    SpecRepairs = 0;
+    SpecExposed = 0;
+    SpecExposedWrong = 0;
+  }
+  if (LoopMode)
+  {
+    init_loop(LoopOverride, LoopBits, table_arena());
+    LoopWith = -1;
+    LoopLastValid = 0;
+    LoopOverrides = 0;
+    LoopRemoved = 0;
+    LoopAdded = 0;
+  }
+}
+
+void report_predictor_stats()
 {
+  switch (bpType)
+  {
+  case CUSTOM:
+    report_custom_stats();
+    break;
+  default:
+    printf("Provider statistics: not kept by %s\n", bpName[bpType]);
+    break;
+  }
+}
 
-  // Make a prediction based on the bpType
+static void cleanup_type(int type)
+{
+  switch (type)
+  {
+  case GSHARE:
+    cleanup_gshare();
+    break;
+  case TOURNAMENT:
+    cleanup_tournament();
+    break;
+  case CUSTOM:
+    cleanup_custom();
+    break;
+  case PERCEPTRON:
+    cleanup_perceptron();
+    break;
+  case MULTIPERSPECTIVE:
+    cleanup_mpp();
+    break;
+  default:
+    break;
+  }
+}
+
+void cleanup_predictor()
+{
+  if (LoopMode)
+  {
+    cleanup_loop(LoopOverride);
+    predictorArena.release(); //the static predictor has no cleanup of its own to release it
+  }
+  if (SpecHistory)
+  {
+    SpecInFlight.release();
+  }
+  cleanup_type(bpType);
+  if (OverrideType >= 0)
+  {
+    cleanup_type(OverrideType);
+  }
+}
+
+
+//lookahead prefetching: the global history a branch D branches ahead will see is the current one
+//shifted by the outcomes in between, all known from the trace, so the global history indexes
+//are exact. Local histories and the custom predictor's folded histories and path are read as they
+//are now and can be stale, which at worst wastes a prefetch.
+void prefetch_predictor(uint32_t pc, uint32_t outcome)
+{
   switch (bpType)
   {
+  case GSHARE:
+    bht_gshare.prefetch((pc ^ lookahead_ghistory) & ((1 << ghistoryBits) - 1));
+    break;
+  case TOURNAMENT:
+    LocalHistTable.prefetch(pc & ((1 << LocalHist_Bits) - 1));
+    GlobalPredict.prefetch((lookahead_ghistory ^ pc) & ((1 << GlobalPred_Bits) - 1));
+    Chooser.prefetch(lookahead_ghistory & ((1 << ChooserBits) - 1)); //read by the prediction
+    Chooser.prefetch((lookahead_ghistory ^ pc) & ((1 << ChooserBits) - 1)); //written by training
+    break;
+  case CUSTOM:
+    BimodalTable.prefetch(pc & ((1 << BimodalBits) - 1));
+    for (int t = 1; t <= TAGE_TABLES; t++)
+    {
+      uint32_t index = tage_index(t, pc);
+      __builtin_prefetch(&TageTag[t][index], 1);
+      TageCtr[t].prefetch(index);
+    }
+    break;
+  case PERCEPTRON:
+    __builtin_prefetch(perceptron_row(pc), 1); //a row is at most 64 bytes (PERCEPTRON_MAX_HIST)
+    break;
+  default:
+    break;
+  }
+  lookahead_ghistory = (lookahead_ghistory << 1) | outcome;
+}
+
+//block simulation: for gshare and the tournament the global history indexes of the whole block come
+//from the vectorized pre-pass in index_stream.cpp, so the serial loop is left with the counter reads
+//and updates (and the tournament's local history, which depends on predictor state). The custom
+//predictor's indexes fold hundreds of outcomes per table, so it keeps the scalar path.
+static void simulate_block_gshare(const uint32_t *pc, const uint8_t *outcome, int n, uint8_t *prediction)
+{
+  uint32_t index[BLOCK_BRANCHES];
+  uint64_t packed = block_pack_outcomes(outcome, n);
+  block_xor_index(ghistory, packed, pc, n, (1 << ghistoryBits) - 1, index);
+
+  for (int i = 0; i < n; i++)
+  {
+    uint32_t state = bht_gshare.get(index[i]);
+    prediction[i] = SatCounter<2>::predict(state);
+    bht_gshare.set(index[i], SatCounter<2>::next(state, outcome[i]));
+  }
+  ghistory = block_history_after(ghistory, packed, n);
+}
+
+static void simulate_block_tournament(const uint32_t *pc, const uint8_t *outcome, int n, uint8_t *prediction)
+{
+  uint32_t indexGP[BLOCK_BRANCHES]; //global predictor, (ghr ^ pc)
+  uint32_t indexChooserPredict[BLOCK_BRANCHES]; //chooser as read by tournament_predict, (ghr)
+  uint32_t indexChooserTrain[BLOCK_BRANCHES]; //chooser as trained by train_tournament, (ghr ^ pc)
+  uint64_t packed = block_pack_outcomes(outcome, n);
+  block_xor_index(ghistory_tournament, packed, pc, n, (1 << GlobalPred_Bits) - 1, indexGP);
+  block_hist_index(ghistory_tournament, packed, n, (1 << ChooserBits) - 1, indexChooserPredict);
+  block_xor_index(ghistory_tournament, packed, pc, n, (1 << ChooserBits) - 1, indexChooserTrain);
+
+  uint32_t localHistMask = (1 << LocalHist_Bits) - 1;
+  uint32_t localPredMask = (1 << LocalPred_Bits) - 1;
+  for (int i = 0; i < n; i++)
+  {
+    uint32_t indexLP1 = pc[i] & localHistMask;
+    uint32_t localHist = LocalHistTable.get(indexLP1);
+    uint32_t indexLP2 = localHist & localPredMask;
+
+    uint32_t localState = LocalPredictTable.get(indexLP2);
+    uint32_t globalState = GlobalPredict.get(indexGP[i]);
+    uint32_t localPred = SatCounter<2>::predict(localState);
+    uint32_t globalPred = SatCounter<2>::predict(globalState);
+    prediction[i] = chooser_uses_local(Chooser.get(indexChooserPredict[i])) ? localPred : globalPred;
+
+    //same updates, in the same order, as train_tournament
+    uint32_t disagree = localPred ^ globalPred;
+    uint32_t globalCorrect = (outcome[i] == globalPred);
+    Chooser.set(indexChooserTrain[i], ChooserNext[Chooser.get(indexChooserTrain[i])][(disagree << 1) | globalCorrect]);
+    LocalPredictTable.set(indexLP2, SatCounter<2>::next(localState, outcome[i]));
+    GlobalPredict.set(indexGP[i], SatCounter<2>::next(globalState, outcome[i]));
+    LocalHistTable.set(indexLP1, (localHist << 1) | outcome[i]);
+  }
+  ghistory_tournament = block_history_after(ghistory_tournament, packed, n);
+}
+
+//the perceptron's output serves both the prediction and the training decision, so it is computed once
+static void simulate_block_perceptron(const uint32_t *pc, const uint8_t *outcome, int n, uint8_t *prediction)
+{
+  for (int i = 0; i < n; i++)
+  {
+    int8_t *row = perceptron_row(pc[i]);
+    int output = perceptron_output(row, ghistory_perceptron, PerceptronHist);
+    prediction[i] = output >= 0 ? TAKEN : NOTTAKEN;
+    perceptron_update(row, output, outcome[i]);
+  }
+}
+
+void simulate_block(const branchRecord *b, int n, uint8_t *prediction)
+{
+  if (LoopMode || UpdateDelay || SpecHistory || OverrideType >= 0 || (bpType != GSHARE && bpType != TOURNAMENT && bpType != PERCEPTRON))
+  {
+    for (int i = 0; i < n; i++)
+    {
+      if (b[i].condition)
+      {
+        prediction[i] = make_prediction(b[i].pc, b[i].target, b[i].direct);
+      }
+      train_predictor(b[i].pc, b[i].target, b[i].outcome, b[i].condition, b[i].call, b[i].ret, b[i].direct);
+    }
+    return;
+  }
+
+  //only conditional branches touch these predictors
+  uint32_t pc[BLOCK_BRANCHES];
+  uint8_t outcome[BLOCK_BRANCHES];
+  uint8_t condPrediction[BLOCK_BRANCHES];
+  int conditional = 0;
+  for (int i = 0; i < n; i++)
+  {
+    if (b[i].condition)
+    {
+      pc[conditional] = b[i].pc;
+      outcome[conditional] = b[i].outcome;
+      conditional++;
+    }
+  }
+
+  if (bpType == GSHARE)
+  {
+    simulate_block_gshare(pc, outcome, conditional, condPrediction);
+  }
+  else if (bpType == TOURNAMENT)
+  {
+    simulate_block_tournament(pc, outcome, conditional, condPrediction);
+  }
+  else
+  {
+    simulate_block_perceptron(pc, outcome, conditional, condPrediction);
+  }
+
+  for (int i = 0, c = 0; i < n; i++)
+  {
+    if (b[i].condition)
+    {
+      prediction[i] = condPrediction[c++];
+    }
+  }
+}
+
+//flip the global history bit 'distance' branches back in every register and fold of predictor 'type'
+static void spec_repair(int type, uint64_t distance){
+  switch(type){
+  case GSHARE:
+    ghistory^= distance < 64 ? 1ull << distance : 0;
+    break;
+  case TOURNAMENT:
+    ghistory_tournament^= distance < 32 ? 1u << distance : 0;
+    break;
+  case CUSTOM:
+    if(distance < ghistory_custom.capacity()){
+      ghistory_custom.flip(distance);
+      for(int t=1; t<=TAGE_TABLES; t++){
+        TageFold[t].flip(distance);
+        TageTagFold[t].flip(distance);
+        TageTagFold2[t].flip(distance);
+      }
+    }
+    break;
+  case PERCEPTRON:
+    ghistory_perceptron^= distance < 64 ? 1ull << distance : 0;
+    break;
+  case MULTIPERSPECTIVE:
+    ghistory_mpp^= distance < 64 ? 1ull << distance : 0;
+    break;
+  default:
+    break;
+  }
+}
+
+//repair the branch just shifted into the history if it was mispredicted, before the next one is predicted
+static void spec_resolve(uint8_t outcome){
+  SpecCheckpoint c= {SpecSeq++, SpecPrediction != outcome}, due= c;
+  if(SpecWrongInFlight){
+    SpecExposed++;
+    SpecExposedWrong+= c.wrong;
+  }
+  SpecWrongInFlight+= c.wrong;
+  if((SpecResolve == 0 || SpecInFlight.shift(c, &due)) && due.wrong){
+    spec_repair(bpType, SpecSeq - 1 - due.seq);
+    if(OverrideType >= 0){
+      spec_repair(OverrideType, SpecSeq - 1 - due.seq);
+    }
+    SpecWrongInFlight--;
+    SpecRepairs++;
+  }
+}
+
+void report_spec_history(uint64_t branches, uint64_t mispredictions, int64_t oracleMispredictions){
+  printf("\nSpeculative history: %s, mispredictions repaired %d branches after prediction\n", bpName[bpType],
+         SpecResolve);
+  printf("  repairs:         %10llu\n", (unsigned long long)SpecRepairs);
+  printf("  exposed:         %10llu  predictions with a wrong bit in the history\n", (unsigned long long)SpecExposed);
+  printf("  exposed wrong:   %10llu  (%.2f%% of them mispredicted)\n", (unsigned long long)SpecExposedWrong,
+         SpecExposed ? 100.0 * SpecExposedWrong / SpecExposed : 0.0);
+  printf("  speculative:     %10llu  (%.3f per 1000 branches)\n", (unsigned long long)mispredictions,
+         1000.0 * mispredictions / (branches ? branches : 1));
+  if(SpecResolve == 0){
+    printf("  oracle history:  the same (repaired before the next branch, the trace has no wrong path)\n");
+    return;
+  }
+  if(oracleMispredictions < 0){
+    printf("  oracle history:  unavailable (the trace can't be rewound)\n");
+    return;
+  }
+  printf("  oracle history:  %10llu  (%.3f per 1000 branches)\n", (unsigned long long)oracleMispredictions,
+         1000.0 * oracleMispredictions / (branches ? branches : 1));
+  printf("  difference:      %10lld  (%.3f per 1000 branches)\n", (long long)mispredictions - oracleMispredictions,
+         1000.0 * ((int64_t)mispredictions - oracleMispredictions) / (branches ? branches : 1));
+}
+
+//score the fast prediction against the final one, which SpecPrediction holds
+static void train_override(uint8_t outcome){
+  OverrideFastWrong+= OverrideFastPred != outcome;
+  if(OverrideFastPred != SpecPrediction){
+    OverrideCount++;
+    OverrideFixed+= SpecPrediction == outcome;
+    OverrideBroke+= OverrideFastPred == outcome;
+  }
+  OverrideLastValid= 0;
+}
+
+void report_override(uint64_t branches, uint64_t mispredictions, int penalty){
+  int64_t saved= (int64_t)OverrideFastWrong - (int64_t)mispredictions;
+  uint64_t bubbles= OverrideCount * OverrideLatency;
+  printf("\nOverriding predictor: %s (fast) overridden by %s after %d cycles\n", bpName[OverrideType],
+         bpName[bpType], OverrideLatency);
+  printf("  fast alone:      %10llu  (%.3f per 1000 branches)\n", (unsigned long long)OverrideFastWrong,
+         1000.0 * OverrideFastWrong / (branches ? branches : 1));
+  printf("  with override:   %10llu  (%.3f per 1000 branches)\n", (unsigned long long)mispredictions,
+         1000.0 * mispredictions / (branches ? branches : 1));
+  printf("  overrides:       %10llu  (%llu fixed, %llu broke a fast hit)\n", (unsigned long long)OverrideCount,
+         (unsigned long long)OverrideFixed, (unsigned long long)OverrideBroke);
+  printf("  bubbles:         %10llu  cycles (%.3f per 1000 branches)\n", (unsigned long long)bubbles,
+         1000.0 * bubbles / (branches ? branches : 1));
+  printf("  net:             %10lld  cycles saved at a %d-cycle misprediction penalty\n",
+         (long long)(saved * penalty - (int64_t)bubbles), penalty);
+}
+
+//predictor 'type''s own prediction, before any --loop override
+static uint32_t type_prediction(int type, uint32_t pc, uint32_t target, uint32_t direct)
+{
+
+  // Make a prediction based on the bpType
+  switch (type)
+  {
   case STATIC:
     return TAKEN;
   case GSHARE:
@@ -859,6 +1511,10 @@ uint32_t make_prediction(uint32_t pc, uint32_t target, uint32_t direct)
     return tournament_predict(pc);
   case CUSTOM:
     return custom_predict(pc);
+  case PERCEPTRON:
+    return perceptron_predict(pc);
+  case MULTIPERSPECTIVE:
+    return mpp_predict(pc);
   default:
     break;
   }
@@ -867,27 +1523,86 @@ uint32_t make_prediction(uint32_t pc, uint32_t target, uint32_t direct)
   return NOTTAKEN;
 }
 
-// Train the predictor the last executed branch at PC 'pc' and with
-// outcome 'outcome' (true indicates that the branch was taken, false
-// indicates that the branch was not taken)
+// Make a prediction for conditional branch instruction at PC 'pc'
+// Returning TAKEN indicates a prediction of taken; returning NOTTAKEN
+// indicates a prediction of not taken
 //
+uint32_t make_prediction(uint32_t pc, uint32_t target, uint32_t direct)
+{
+  uint32_t prediction = type_prediction(bpType, pc, target, direct);
+  if (OverrideType >= 0)
+  {
+    OverrideLastPC = pc;
+    OverrideLastValid = 1;
+    OverrideFastPred = type_prediction(OverrideType, pc, target, direct);
+  }
+  if (LoopMode)
+  {
+    prediction = loop_compose(pc, prediction);
+  }
+  SpecPrediction = prediction;
+  return prediction;
+}
 
-void train_predictor(uint32_t pc, uint32_t target, uint32_t outcome, uint32_t condition, uint32_t call, uint32_t ret, uint32_t direct)
+//train predictor 'type' with a record
+static void train_type(int type, uint32_t pc, uint32_t target, uint32_t outcome, uint32_t condition, uint32_t call, uint32_t ret)
 {
-  if (condition)
+  if (type == MULTIPERSPECTIVE) //also follows calls, returns and unconditional branches
   {
-    switch (bpType)
+    train_mpp(pc, target, outcome, condition, call, ret);
+  }
+  else if (condition)
+  {
+    switch (type)
     {
-    case STATIC:
-      return;
     case GSHARE:
-      return train_gshare(pc, outcome);
+      train_gshare(pc, outcome);
+      break;
     case TOURNAMENT:
-      return train_tournament(pc, outcome);
+      train_tournament(pc, outcome);
+      break;
     case CUSTOM:
-      return train_custom(pc, outcome);
+      train_custom(pc, outcome);
+      break;
+    case PERCEPTRON:
+      train_perceptron(pc, outcome);
+      break;
     default:
       break;
     }
   }
 }
+
+// Train the predictor the last executed branch at PC 'pc' and with
+// outcome 'outcome' (true indicates that the branch was taken, false
+// indicates that the branch was not taken)
+//
+
+void train_predictor(uint32_t pc, uint32_t target, uint32_t outcome, uint32_t condition, uint32_t call, uint32_t ret, uint32_t direct)
+{
+  if (LoopMode && condition)
+  {
+    if (!(LoopLastValid && LoopLastPC == pc)) //trained without a prediction first
+    {
+      make_prediction(pc, target, direct);
+    }
+    train_loop_override(pc, outcome);
+  }
+  if (OverrideType >= 0 && condition)
+  {
+    if (!(OverrideLastValid && OverrideLastPC == pc)) //trained without a prediction first
+    {
+      make_prediction(pc, target, direct);
+    }
+    train_override(outcome);
+  }
+  if (OverrideType >= 0)
+  {
+    train_type(OverrideType, pc, target, outcome, condition, call, ret);
+  }
+  train_type(bpType, pc, target, outcome, condition, call, ret);
+  if (SpecHistory && condition)
+  {
+    spec_resolve(outcome);
+  }
+}
@@ -76,6 +76,129 @@ void train_predictor(uint32_t pc, uint32_t target, uint32_t outcome, uint32_t co
 // Please add your code below, and DO NOT MODIFY ANY OF THE CODE ABOVE
 // 
 
+// Predictor types added after the skeleton's (bpName has an entry for each)
+#define PERCEPTRON 4
+#define MULTIPERSPECTIVE 5
+
+// Print the active predictor's storage, table by table, against the
+// 256 Kbit + 1024 bit budget
+//
+void report_budget();
+
+// Print where the active predictor's predictions came from (--stats);
+// the custom predictor breaks them down by provider table, alternate,
+// statistical corrector and loop predictor
+//
+void report_predictor_stats();
+
+// Free the active predictor's tables
+//
+void cleanup_predictor();
+
+// Prefetch the table entries conditional branch 'pc' (outcome 'outcome')
+// will use. Called in trace order, some distance ahead of predicting
+// and training the branch; only affects timing, never predictions.
+//
+void prefetch_predictor(uint32_t pc, uint32_t outcome);
+
+// One record of the trace
+typedef struct
+{
+  uint32_t pc, target, outcome, condition, call, ret, direct;
+} branchRecord;
+
+// Predict and train 'n' (at most BLOCK_BRANCHES, see index_stream.h)
+// consecutive trace records, exactly as make_prediction() followed by
+// train_predictor() for each record in turn would. prediction[i] is
+// set for every conditional record.
+//
+void simulate_block(const branchRecord *b, int n, uint8_t *prediction);
+
+// Tournament predictor table sizes (log2 entries), shared with the analyzers
+extern int LocalHist_Bits;
+extern int LocalPred_Bits;
+extern int GlobalPred_Bits;
+extern int ChooserBits;
+
+#include "history.h"
+#include "arena.h"
+
+// Arena holding the active predictor's tables (see --arena)
+extern Arena predictorArena;
+
+// Custom predictor (TAGE-SC-L): the tagged tables' history lengths run
+// geometrically from TageMinHist to TageMaxHist, set by --custom:
+#define TAGE_TABLES 12
+#define TAGE_MAX_HIST 2048
+extern int TageMinHist;
+extern int TageMaxHist;
+
+// Perceptron history length (at most PERCEPTRON_MAX_HIST) and log2
+// number of perceptrons, set by --perceptron:
+extern int PerceptronHist;
+extern int PerceptronBits;
+
+// Multiperspective perceptron: log2 weights per feature and the
+// feature list (MppCount = 0 for the defaults), set by --mpp:
+struct MppFeature;
+extern int MppBits;
+extern MppFeature MppFeatures[];
+extern int MppCount;
+
+// Loop predictor composed over the active predictor, set by --loop:
+// LoopMode = 1 turns it on, with 2^LoopBits entries
+extern int LoopMode;
+extern int LoopBits;
+
+// Delayed update, set by --delay: table updates are applied this many
+// conditional branches after the prediction (0 = at once)
+#define UPDATE_DELAY_MAX 4096
+extern int UpdateDelay;
+
+// Overriding pair, set by --override: OverrideType (-1 = off) is the
+// fast predictor, overridden by the active one after OverrideLatency
+// cycles wherever they disagree
+extern int OverrideType;
+extern int OverrideLatency;
+extern uint64_t OverrideCount; // slow predictions that overrode the fast one
+
+// Print the fast predictor's mispredictions against the final
+// 'mispredictions', the overrides and their bubbles, and the cycles
+// the pair saves over the fast predictor alone when a misprediction
+// costs 'penalty' cycles
+//
+void report_override(uint64_t branches, uint64_t mispredictions, int penalty);
+
+// Speculative global history, set by --spec-history: branches shift
+// their predicted direction into the global history and a mispredicted
+// one is repaired SpecResolve branches later (0 = before the next one)
+#define SPEC_RESOLVE_MAX 4096
+extern int SpecHistory;
+extern int SpecResolve;
+
+// Print the repairs, the predictions made with a wrong history bit
+// and the mispredictions under speculative history
+// against 'oracleMispredictions' from the same trace with the true
+// outcomes in the history (-1 if that pass couldn't be run; unused
+// when SpecResolve is 0, where the two histories are the same)
+//
+void report_spec_history(uint64_t branches, uint64_t mispredictions, int64_t oracleMispredictions);
+
+// Print how many of the active predictor's mispredictions the --loop
+// override removed (and added), out of 'branches' conditional branches
+//
+void report_loop_override(uint64_t branches);
+
+// Custom predictor internals, exposed for the microbenchmarks
+extern LongHistory ghistory_custom;
+void init_custom();
+uint8_t custom_predict(uint32_t pc);
+void cleanup_custom();
+
+// Tag compare for the tagged tables: bit t of the result is set when
+// table t holds tag[t] at index[t] (t = 1..TAGE_TABLES)
+//
+uint32_t tage_match_mask(const uint32_t *index, const uint16_t *tag);
 
 
 #endif
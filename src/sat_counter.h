@@ -0,0 +1,74 @@
+//========================================================//
+//  sat_counter.h                                         //
+//  Branchless saturating counters and chooser states     //
+//                                                        //
+//  The next state is computed with compares folded into  //
+//  arithmetic (setcc/cmov), so training never depends on //
+//  the host's branch predictor guessing the counter      //
+//========================================================//
+
+#ifndef SAT_COUNTER_H
+#define SAT_COUNTER_H
+
+#include <stdint.h>
+
+// An unsigned 'Bits'-wide saturating counter. Values are plain
+// integers so they can live in any storage (PackedArray, structs);
+// these helpers only compute states.
+//
+template <unsigned Bits>
+struct SatCounter
+{
+  static_assert(Bits >= 1 && Bits <= 16, "SatCounter width must be 1..16 bits");
+
+  static const uint32_t MAX = (1u << Bits) - 1;
+  static const uint32_t WEAK_TAKEN = 1u << (Bits - 1); // lowest state predicting taken
+
+  // Direction predicted by counter value 'v': the top bit
+  static inline uint32_t predict(uint32_t v)
+  {
+    return v >> (Bits - 1);
+  }
+
+  static inline uint32_t inc(uint32_t v)
+  {
+    return v + (v < MAX);
+  }
+
+  static inline uint32_t dec(uint32_t v)
+  {
+    return v - (v > 0);
+  }
+
+  // +1 if 'cond', saturating at MAX
+  static inline uint32_t inc_if(uint32_t v, uint32_t cond)
+  {
+    return v + (cond & (v < MAX));
+  }
+
+  // Train towards 'taken' (0 or 1): +1 on taken, -1 on not taken
+  static inline uint32_t next(uint32_t v, uint32_t taken)
+  {
+    return v + (taken & (v < MAX)) - ((taken ^ 1) & (v > 0));
+  }
+};
+
+// Tournament chooser (global_strong .. local_strong, see predictor.h).
+// Indexed by [state][(disagree << 1) | globalCorrect]: the state only
+// moves when the two components disagree, towards global when the
+// global component was right and towards local otherwise.
+//
+static const uint8_t ChooserNext[4][4] = {
+    /* global_strong */ {0, 0, 1, 0},
+    /* global_weak   */ {1, 1, 2, 0},
+    /* local_weak    */ {2, 2, 3, 1},
+    /* local_strong  */ {3, 3, 3, 2},
+};
+
+// Non-zero when chooser 'state' selects the local component
+static inline uint32_t chooser_uses_local(uint32_t state)
+{
+  return state >> 1;
+}
+
+#endif
@@ -0,0 +1,316 @@
+//========================================================//
+//  sweep.cpp                                             //
+//  Source file for the multi-configuration gshare sweep  //
+//                                                        //
+//  Each configuration (table bits t, history bits h) is  //
+//  a lane indexing its own 2-bit counters with           //
+//  (pc ^ (ghist & (2^h-1))) & (2^t-1). All tables share  //
+//  one byte array, so a lane is an offset and two masks, //
+//  and 16 (AVX-512) or 8 (AVX2) lanes step through a     //
+//  branch with 64-bit-indexed gathers and scatters       //
+//========================================================//
+#include <stdio.h>
+#include <string.h>
+#include <immintrin.h>
+#include "predictor.h"
+#include "sweep.h"
+#include "arena.h"
+#include "sat_counter.h"
+#include "isa.h"
+
+//------------------------------------//
+//        Sweep Configuration         //
+//------------------------------------//
+int sweepMode = 0;
+int sweepMinBits = 10;
+int sweepMaxBits = 18;
+int sweepHistStep = 2;
+
+#define SWEEP_MAX_BITS 28
+#define SWEEP_GROUP 16 // lanes per step of the widest kernel; lane arrays are padded to it
+
+//------------------------------------//
+//       Sweep Data Structures        //
+//------------------------------------//
+
+int sweepLanes;          // configurations
+int sweepPadded;         // sweepLanes rounded up to SWEEP_GROUP
+uint32_t *laneTableBits; // t of each lane
+uint32_t *laneHistBits;  // h of each lane
+uint64_t *laneOffset;    // byte offset of the lane's table in sweepCounters (the tables can pass 2 GiB)
+uint32_t *laneTableMask; // 2^t - 1
+uint32_t *laneHistMask;  // 2^h - 1
+uint32_t *lanePrediction; // prediction of each lane for the current branch
+uint64_t *laneMispredicts;
+
+uint8_t *sweepCounters;  // every lane's 2-bit counters, one byte each
+Arena sweepArena;
+uint64_t sweep_ghistory;
+
+// Check mode: a plain scalar copy of every lane, stepped like gshare_predict/train_gshare
+uint8_t *checkCounters;
+uint64_t checkBranches;
+uint64_t checkErrors;
+int gshareLane;          // lane configured like the simulated gshare, or -1
+uint64_t gshareErrors;
+
+const char *sweep_isa()
+{
+  return isaName[current_isa()];
+}
+
+//------------------------------------//
+//           Sweep Kernels            //
+//------------------------------------//
+
+static void sweep_scalar(uint32_t pc, uint32_t outcome, uint32_t hist)
+{
+  for (int l = 0; l < sweepLanes; l++)
+  {
+    uint8_t *c = &sweepCounters[laneOffset[l] + ((pc ^ (hist & laneHistMask[l])) & laneTableMask[l])];
+    lanePrediction[l] = SatCounter<2>::predict(*c);
+    laneMispredicts[l] += lanePrediction[l] != outcome;
+    *c = SatCounter<2>::next(*c, outcome);
+  }
+}
+
+// Next counter values of 8 lanes: +1 below 3 when taken, -1 above 0 when not
+__attribute__((target("avx2"))) static inline __m256i next_avx2(__m256i c, __m256i taken)
+{
+  __m256i up = _mm256_sub_epi32(c, _mm256_cmpgt_epi32(_mm256_set1_epi32(3), c));
+  __m256i down = _mm256_add_epi32(c, _mm256_cmpgt_epi32(c, _mm256_setzero_si256()));
+  return _mm256_blendv_epi8(down, up, taken);
+}
+
+// AVX2 has gathers but no scatters: the new counters are stored lane by lane
+__attribute__((target("avx2"))) static void sweep_avx2(uint32_t pc, uint32_t outcome, uint32_t hist)
+{
+  __m256i pcv = _mm256_set1_epi32(pc);
+  __m256i histv = _mm256_set1_epi32(hist);
+  __m256i taken = _mm256_set1_epi32(outcome ? -1 : 0);
+  __m256i byteMask = _mm256_set1_epi32(0xff);
+  uint64_t addr[8];
+  uint32_t next[8];
+  for (int l = 0; l < sweepLanes; l += 8)
+  {
+    __m256i hm = _mm256_loadu_si256((const __m256i *)(laneHistMask + l));
+    __m256i tm = _mm256_loadu_si256((const __m256i *)(laneTableMask + l));
+    __m256i index = _mm256_and_si256(_mm256_xor_si256(pcv, _mm256_and_si256(histv, hm)), tm);
+    // 64-bit addresses, four lanes per gather
+    __m256i lo = _mm256_add_epi64(_mm256_loadu_si256((const __m256i *)(laneOffset + l)),
+                                  _mm256_cvtepu32_epi64(_mm256_castsi256_si128(index)));
+    __m256i hi = _mm256_add_epi64(_mm256_loadu_si256((const __m256i *)(laneOffset + l + 4)),
+                                  _mm256_cvtepu32_epi64(_mm256_extracti128_si256(index, 1)));
+    __m256i w = _mm256_set_m128i(_mm256_i64gather_epi32((const int *)sweepCounters, hi, 1),
+                                 _mm256_i64gather_epi32((const int *)sweepCounters, lo, 1));
+    __m256i c = _mm256_and_si256(w, byteMask);
+    __m256i pred = _mm256_srli_epi32(c, 1);
+    _mm256_storeu_si256((__m256i *)(lanePrediction + l), pred);
+    _mm256_storeu_si256((__m256i *)addr, lo);
+    _mm256_storeu_si256((__m256i *)(addr + 4), hi);
+    _mm256_storeu_si256((__m256i *)next, next_avx2(c, taken));
+    int lanes = sweepLanes - l < 8 ? sweepLanes - l : 8;
+    for (int i = 0; i < lanes; i++)
+    {
+      sweepCounters[addr[i]] = next[i];
+      laneMispredicts[l + i] += lanePrediction[l + i] != outcome;
+    }
+  }
+}
+
+// Gather the 32-bit words starting at each lane's counter, replace the low
+// byte and scatter them back; lanes never share a table, so the other three
+// bytes are written back unchanged
+__attribute__((target("avx512f"))) static void sweep_avx512(uint32_t pc, uint32_t outcome, uint32_t hist)
+{
+  __m512i pcv = _mm512_set1_epi32(pc);
+  __m512i histv = _mm512_set1_epi32(hist);
+  __m512i outv = _mm512_set1_epi32(outcome);
+  __m512i byteMask = _mm512_set1_epi32(0xff);
+  __mmask16 taken = outcome ? 0xffff : 0;
+  for (int l = 0; l < sweepLanes; l += 16)
+  {
+    __mmask16 active = sweepLanes - l < 16 ? (__mmask16)((1u << (sweepLanes - l)) - 1) : 0xffff;
+    __m512i hm = _mm512_loadu_si512(laneHistMask + l);
+    __m512i tm = _mm512_loadu_si512(laneTableMask + l);
+    __m512i index = _mm512_and_si512(_mm512_xor_si512(pcv, _mm512_and_si512(histv, hm)), tm);
+    // 64-bit addresses, eight lanes per gather
+    __m512i lo = _mm512_add_epi64(_mm512_loadu_si512(laneOffset + l),
+                                  _mm512_cvtepu32_epi64(_mm512_castsi512_si256(index)));
+    __m512i hi = _mm512_add_epi64(_mm512_loadu_si512(laneOffset + l + 8),
+                                  _mm512_cvtepu32_epi64(_mm512_extracti64x4_epi64(index, 1)));
+    __mmask8 activeLo = (__mmask8)active, activeHi = (__mmask8)(active >> 8);
+    __m512i w = _mm512_inserti64x4(
+        _mm512_castsi256_si512(_mm512_mask_i64gather_epi32(_mm256_setzero_si256(), activeLo, lo, sweepCounters, 1)),
+        _mm512_mask_i64gather_epi32(_mm256_setzero_si256(), activeHi, hi, sweepCounters, 1), 1);
+    __m512i c = _mm512_and_si512(w, byteMask);
+    __m512i pred = _mm512_srli_epi32(c, 1);
+    _mm512_storeu_si512(lanePrediction + l, pred);
+
+    __mmask16 canUp = _mm512_cmplt_epu32_mask(c, _mm512_set1_epi32(3));
+    __mmask16 canDown = _mm512_cmpgt_epu32_mask(c, _mm512_setzero_si512());
+    __m512i next = _mm512_mask_add_epi32(c, canUp & taken, c, _mm512_set1_epi32(1));
+    next = _mm512_mask_sub_epi32(next, canDown & ~taken, c, _mm512_set1_epi32(1));
+    w = _mm512_or_si512(_mm512_andnot_si512(byteMask, w), next);
+    _mm512_mask_i64scatter_epi32(sweepCounters, activeLo, lo, _mm512_castsi512_si256(w), 1);
+    _mm512_mask_i64scatter_epi32(sweepCounters, activeHi, hi, _mm512_extracti64x4_epi64(w, 1), 1);
+
+    __mmask16 wrong = _mm512_mask_cmpneq_epu32_mask(active, pred, outv);
+    while (wrong)
+    {
+      laneMispredicts[l + __builtin_ctz(wrong)]++;
+      wrong &= wrong - 1;
+    }
+  }
+}
+
+//------------------------------------//
+//          Sweep Functions           //
+//------------------------------------//
+
+void init_sweep()
+{
+  if (sweepMinBits < 1)
+    sweepMinBits = 1;
+  if (sweepMaxBits > SWEEP_MAX_BITS)
+    sweepMaxBits = SWEEP_MAX_BITS;
+  if (sweepMaxBits < sweepMinBits)
+    sweepMaxBits = sweepMinBits;
+  if (sweepHistStep < 1)
+    sweepHistStep = 1;
+
+  // lanes: every table size with history 0 (bimodal), step, 2*step, ... and t
+  sweepLanes = 0;
+  for (int t = sweepMinBits; t <= sweepMaxBits; t++)
+    sweepLanes += (t + sweepHistStep - 1) / sweepHistStep + 1;
+  sweepPadded = (sweepLanes + SWEEP_GROUP - 1) / SWEEP_GROUP * SWEEP_GROUP;
+
+  laneTableBits = (uint32_t *)calloc(sweepPadded, sizeof(uint32_t));
+  laneHistBits = (uint32_t *)calloc(sweepPadded, sizeof(uint32_t));
+  laneOffset = (uint64_t *)calloc(sweepPadded, sizeof(uint64_t));
+  laneTableMask = (uint32_t *)calloc(sweepPadded, sizeof(uint32_t));
+  laneHistMask = (uint32_t *)calloc(sweepPadded, sizeof(uint32_t));
+  lanePrediction = (uint32_t *)calloc(sweepPadded, sizeof(uint32_t));
+  laneMispredicts = (uint64_t *)calloc(sweepPadded, sizeof(uint64_t));
+
+  uint64_t bytes = 0;
+  gshareLane = -1;
+  int l = 0;
+  for (int t = sweepMinBits; t <= sweepMaxBits; t++)
+  {
+    for (int h = 0; h <= t; h = (h < t && h + sweepHistStep > t) ? t : h + sweepHistStep)
+    {
+      laneTableBits[l] = t;
+      laneHistBits[l] = h;
+      laneTableMask[l] = (1u << t) - 1;
+      laneHistMask[l] = (1u << h) - 1;
+      laneOffset[l] = bytes;
+      if (bpType == GSHARE && t == ghistoryBits && h == ghistoryBits)
+        gshareLane = l;
+      bytes += (1u << t) + 4; // +4: a 32-bit gather of the last counter stays inside
+      l++;
+    }
+  }
+
+  sweepCounters = (uint8_t *)sweepArena.alloc(bytes);
+  for (l = 0; l < sweepLanes; l++)
+    memset(sweepCounters + laneOffset[l], WN, 1u << laneTableBits[l]);
+  if (sweepMode == 2)
+  {
+    checkCounters = (uint8_t *)malloc(bytes);
+    memcpy(checkCounters, sweepCounters, bytes);
+  }
+  sweep_ghistory = 0;
+  checkBranches = checkErrors = gshareErrors = 0;
+  current_isa();
+}
+
+void sweep_update(uint32_t pc, uint32_t outcome, uint32_t prediction)
+{
+  uint32_t hist = (uint32_t)sweep_ghistory;
+  switch (activeIsa)
+  {
+  case ISA_AVX512:
+    sweep_avx512(pc, outcome, hist);
+    break;
+  case ISA_AVX2:
+    sweep_avx2(pc, outcome, hist);
+    break;
+  default:
+    sweep_scalar(pc, outcome, hist);
+    break;
+  }
+
+  if (sweepMode == 2)
+  {
+    // the scalar copy of each lane, written the way gshare_predict/train_gshare are
+    for (int l = 0; l < sweepLanes; l++)
+    {
+      uint32_t pc_lower_bits = pc & laneTableMask[l];
+      uint32_t ghistory_lower_bits = hist & laneHistMask[l];
+      uint8_t *c = &checkCounters[laneOffset[l] + (pc_lower_bits ^ ghistory_lower_bits)];
+      if (SatCounter<2>::predict(*c) != lanePrediction[l] && checkErrors++ == 0)
+      {
+        printf("Sweep check: lane %d (t=%u h=%u) differs at branch %llu\n",
+               l, laneTableBits[l], laneHistBits[l], (unsigned long long)checkBranches);
+      }
+      *c = SatCounter<2>::next(*c, outcome);
+    }
+    if (gshareLane >= 0 && lanePrediction[gshareLane] != prediction && gshareErrors++ == 0)
+    {
+      printf("Sweep check: lane %d differs from gshare_predict at branch %llu\n",
+             gshareLane, (unsigned long long)checkBranches);
+    }
+    checkBranches++;
+  }
+
+  sweep_ghistory = (sweep_ghistory << 1) | outcome;
+}
+
+void sweep_report(uint64_t num_branches)
+{
+  printf("\nGshare sweep: %d configurations in one pass (%s lanes, * = best history per size)\n",
+         sweepLanes, isaName[activeIsa]);
+  printf("%5s %5s %10s %10s\n", "Bits", "Hist", "Incorrect", "Rate");
+  for (int l = 0; l < sweepLanes;)
+  {
+    // lanes of one table size are contiguous
+    int end = l;
+    int best = l;
+    while (end < sweepLanes && laneTableBits[end] == laneTableBits[l])
+    {
+      if (laneMispredicts[end] < laneMispredicts[best])
+        best = end;
+      end++;
+    }
+    for (; l < end; l++)
+    {
+      printf("%5u %4u%c %10llu %10.3f\n", laneTableBits[l], laneHistBits[l], l == best ? '*' : ' ',
+             (unsigned long long)laneMispredicts[l],
+             1000 * ((double)laneMispredicts[l] / (double)(num_branches ? num_branches : 1)));
+    }
+  }
+
+  if (sweepMode == 2)
+  {
+    printf("Sweep check: %s, %d lanes x %llu branches against the scalar gshare update",
+           checkErrors ? "MISMATCH" : "OK", sweepLanes, (unsigned long long)checkBranches);
+    if (gshareLane >= 0)
+      printf("; lane %d vs gshare_predict: %s", gshareLane, gshareErrors ? "MISMATCH" : "OK");
+    printf("\n");
+  }
+}
+
+void cleanup_sweep()
+{
+  free(laneTableBits);
+  free(laneHistBits);
+  free(laneOffset);
+  free(laneTableMask);
+  free(laneHistMask);
+  free(lanePrediction);
+  free(laneMispredicts);
+  free(checkCounters);
+  checkCounters = NULL;
+  sweepArena.release();
+}
@@ -0,0 +1,34 @@
+//========================================================//
+//  sweep.h                                               //
+//  Header file for the multi-configuration gshare sweep  //
+//                                                        //
+//  Simulates a grid of gshare/bimodal configurations in  //
+//  SIMD lanes over a single pass of the trace            //
+//========================================================//
+
+#ifndef SWEEP_H
+#define SWEEP_H
+
+#include <stdint.h>
+
+extern int sweepMode;   // 1 = sweep, 2 = sweep and check every lane
+extern int sweepMinBits; // smallest table (log2 entries)
+extern int sweepMaxBits; // largest table
+extern int sweepHistStep; // history lengths 0, step, 2*step, ... up to the table bits
+
+void init_sweep();
+
+// Advance every configuration by one conditional branch. 'prediction'
+// is the simulated predictor's own, checked against the lane with the
+// same configuration when that predictor is gshare and sweepMode == 2.
+//
+void sweep_update(uint32_t pc, uint32_t outcome, uint32_t prediction);
+
+void sweep_report(uint64_t num_branches);
+void cleanup_sweep();
+
+// Instruction set the lanes run with ("avx512", "avx2" or "scalar")
+//
+const char *sweep_isa();
+
+#endif
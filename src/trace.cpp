@@ -0,0 +1,209 @@
+//========================================================//
+//  trace.cpp                                             //
+//  Source file for the buffered trace reader             //
+//                                                        //
+//  The scalar parser walks the line a character at a     //
+//  time. The AVX2 parser finds all seven separators with //
+//  one 32-byte compare and decodes each hex field with   //
+//  SWAR nibble conversion and a BMI2 pext                //
+//========================================================//
+#include <string.h>
+#include <immintrin.h>
+#include "trace.h"
+#include "isa.h"
+
+#define TRACE_BUFFER (1 << 20)
+#define TRACE_MAX_LINE 256 // refill once fewer bytes than this remain
+#define TRACE_PAD 64       // readable bytes past the data for the vector loads
+
+FILE *traceStream;
+char *traceBuffer;
+const char *tracePos; // next unparsed byte
+const char *traceEnd; // end of the data in the buffer
+int traceEof;
+
+//------------------------------------//
+//           Scalar Parser            //
+//------------------------------------//
+
+static inline int hex_digit(char c)
+{
+  if (c >= '0' && c <= '9')
+    return c - '0';
+  if (c >= 'a' && c <= 'f')
+    return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F')
+    return c - 'A' + 10;
+  return -1;
+}
+
+// Parse a field and skip the separator after it
+static inline const char *hex_field(const char *p, uint32_t *v)
+{
+  if (p[0] == '0' && (p[1] == 'x' || p[1] == 'X'))
+    p += 2;
+  uint32_t x = 0;
+  for (int d; (d = hex_digit(*p)) >= 0; p++)
+    x = (x << 4) | d;
+  *v = x;
+  return *p == '\n' ? p : p + 1;
+}
+
+static inline const char *dec_field(const char *p, uint32_t *v)
+{
+  uint32_t x = 0;
+  for (; *p >= '0' && *p <= '9'; p++)
+    x = x * 10 + (*p - '0');
+  *v = x;
+  return *p == '\n' ? p : p + 1;
+}
+
+static const char *parse_line_scalar(const char *p, branchRecord *b)
+{
+  p = hex_field(p, &b->pc);
+  p = hex_field(p, &b->target);
+  p = dec_field(p, &b->outcome);
+  p = dec_field(p, &b->condition);
+  p = dec_field(p, &b->call);
+  p = dec_field(p, &b->ret);
+  p = dec_field(p, &b->direct);
+  while (*p != '\n')
+    p++;
+  return p + 1;
+}
+
+//------------------------------------//
+//          AVX2 + BMI2 Parser        //
+//------------------------------------//
+
+// Value of the 'len' (0..8) hex digits at 'p'
+__attribute__((target("bmi2"))) static inline uint32_t hex_swar(const char *p, int len)
+{
+  uint64_t v;
+  memcpy(&v, p, 8);
+  // '0'-'9' are 0x30-0x39, 'A'-'F'/'a'-'f' 0x41-0x46/0x61-0x66: the low nibble, +9 for letters
+  uint64_t nibbles = (v & 0x0f0f0f0f0f0f0f0fULL) + ((v >> 6) & 0x0101010101010101ULL) * 9;
+  // first digit into the top byte, then gather the nibbles and drop the missing digits
+  uint64_t digits = _pext_u64(__builtin_bswap64(nibbles), 0x0f0f0f0f0f0f0f0fULL);
+  return (uint32_t)(digits >> (4 * (8 - len)));
+}
+
+__attribute__((target("avx2,bmi2"))) static const char *parse_line_avx2(const char *p, branchRecord *b)
+{
+  __m256i line = _mm256_loadu_si256((const __m256i *)p);
+  uint32_t seps = _mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(line, _mm256_set1_epi8('\t')),
+                                                       _mm256_cmpeq_epi8(line, _mm256_set1_epi8('\n'))));
+  // the common shape: 0x<1-8 hex>\t0x<1-8 hex>\t and five one-digit fields, all in 32 bytes
+  uint32_t s[7];
+  for (int i = 0; i < 7; i++)
+  {
+    if (seps == 0)
+      return parse_line_scalar(p, b);
+    s[i] = __builtin_ctz(seps);
+    seps &= seps - 1;
+  }
+  if (p[s[6]] != '\n' || p[0] != '0' || p[1] != 'x' || p[s[0] + 1] != '0' || p[s[0] + 2] != 'x' ||
+      s[0] > 10 || s[1] - s[0] > 11 || s[2] != s[1] + 2 || s[3] != s[2] + 2 || s[4] != s[3] + 2 ||
+      s[5] != s[4] + 2 || s[6] != s[5] + 2)
+    return parse_line_scalar(p, b);
+
+  b->pc = hex_swar(p + 2, s[0] - 2);
+  b->target = hex_swar(p + s[0] + 3, s[1] - s[0] - 3);
+  b->outcome = p[s[1] + 1] - '0';
+  b->condition = p[s[2] + 1] - '0';
+  b->call = p[s[3] + 1] - '0';
+  b->ret = p[s[4] + 1] - '0';
+  b->direct = p[s[5] + 1] - '0';
+  return p + s[6] + 1;
+}
+
+//------------------------------------//
+//            Trace Reader            //
+//------------------------------------//
+
+const char *trace_parse_line(const char *line, branchRecord *b)
+{
+  return current_isa() >= ISA_AVX2 ? parse_line_avx2(line, b) : parse_line_scalar(line, b);
+}
+
+// Move the unparsed tail to the front and read more; past the data the
+// buffer holds a '\n' (so a last line without one still ends) and zeros
+static void trace_refill()
+{
+  size_t left = traceEnd - tracePos;
+  memmove(traceBuffer, tracePos, left);
+  size_t got = fread(traceBuffer + left, 1, TRACE_BUFFER - left, traceStream);
+  traceEof = (got == 0);
+  tracePos = traceBuffer;
+  traceEnd = traceBuffer + left + got;
+  memset(traceBuffer + left + got, 0, TRACE_PAD);
+  traceBuffer[left + got] = '\n';
+}
+
+void trace_open(FILE *stream)
+{
+  traceStream = stream;
+  traceBuffer = (char *)malloc(TRACE_BUFFER + TRACE_PAD);
+  tracePos = traceEnd = traceBuffer;
+  traceEof = 0;
+  current_isa();
+}
+
+int trace_read(branchRecord *b)
+{
+  while (traceEnd - tracePos < TRACE_MAX_LINE && !traceEof)
+  {
+    trace_refill();
+  }
+  // skip blank lines, stop at the end of the data
+  while (tracePos < traceEnd && *tracePos == '\n')
+  {
+    tracePos++;
+  }
+  if (tracePos >= traceEnd)
+  {
+    return 0;
+  }
+  const char *line = tracePos;
+  tracePos = (activeIsa >= ISA_AVX2) ? parse_line_avx2(tracePos, b) : parse_line_scalar(tracePos, b);
+  if (tracePos > traceEnd && !traceEof)
+  {
+    // a line longer than TRACE_MAX_LINE ran into the end of the data:
+    // read on until its '\n' is in the buffer and parse it again
+    tracePos = line;
+    while (!traceEof && traceEnd - tracePos < TRACE_BUFFER && !memchr(tracePos, '\n', traceEnd - tracePos))
+    {
+      trace_refill();
+    }
+    tracePos = parse_line_scalar(tracePos, b);
+  }
+  if (tracePos > traceEnd)
+  {
+    tracePos = traceEnd; // the last line has no '\n', or a line fills the whole buffer
+  }
+  return 1;
+}
+
+void trace_close()
+{
+  free(traceBuffer);
+  traceBuffer = NULL;
+}
+
+uint64_t trace_instructions(const char *summary)
+{
+  FILE *f = fopen(summary, "r");
+  if (!f)
+  {
+    return 0;
+  }
+  char line[256];
+  unsigned long long count = 0;
+  while (fgets(line, sizeof(line), f))
+  {
+    if (sscanf(line, "!!! Number of Instructions = %llu", &count) == 1)
+      break;
+  }
+  fclose(f);
+  return count;
+}
@@ -0,0 +1,37 @@
+//========================================================//
+//  trace.h                                               //
+//  Header file for the buffered trace reader             //
+//                                                        //
+//  Reads the trace in large blocks and parses each line  //
+//  ("0x%x\t0x%x\t%d\t%d\t%d\t%d\t%d") by hand instead of //
+//  getline + sscanf                                      //
+//========================================================//
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdio.h>
+#include "predictor.h"
+
+void trace_open(FILE *stream);
+
+// Read the next record, returns 0 at the end of the trace
+//
+int trace_read(branchRecord *b);
+
+void trace_close();
+
+// Parse one line starting at 'line' into 'b' with the active
+// instruction set's parser; returns the start of the next line.
+// The line must end in '\n' and at least 32 bytes must be readable
+// from 'line'.
+//
+const char *trace_parse_line(const char *line, branchRecord *b);
+
+// Instruction count from a trace summary file (the "!!! Number of
+// Instructions = N" line tracegen --summary writes); 0 if the file
+// is missing or has no such line
+//
+uint64_t trace_instructions(const char *summary);
+
+#endif
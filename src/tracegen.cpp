@@ -0,0 +1,458 @@
+//========================================================//
+//  tracegen.cpp                                          //
+//  Synthetic branch trace generator                      //
+//                                                        //
+//  Builds a random program (functions made of biased,    //
+//  loop and correlated conditional branches, with calls, //
+//  returns and indirect jumps in between) from a seed    //
+//  and streams its execution in the simulator's trace    //
+//  format, optionally with the .txt summary sidecar      //
+//========================================================//
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <vector>
+
+//------------------------------------//
+//      Generator Configuration       //
+//------------------------------------//
+uint64_t genBranches = 10000000; // conditional branches to emit
+uint64_t genSeed = 1;
+uint32_t genStatic = 1000;       // static conditional branches
+double genBiased = 0.7;          // fraction of non-loop branches that are strongly biased
+double genLoops = 0.1;           // fraction of static branches that close a loop
+uint32_t genTripMin = 4;         // loop trip count range
+uint32_t genTripMax = 64;
+double genCorrelated = 0.1;      // fraction of static branches copying an earlier outcome
+uint32_t genCorrDepth = 16;      // how far back a correlated branch may look
+double genCalls = 0.05;          // chance a branch is followed by a call
+uint32_t genCallDepth = 16;      // maximum call nesting
+double genJumps = 0.05;          // chance a branch is followed by an unconditional jump
+double genIndirect = 0.2;        // fraction of calls and jumps that are indirect
+uint32_t genFanout = 4;          // targets per indirect call or jump
+uint32_t genInsts = 5;           // instructions per trace record, for the sidecar
+const char *genOut = NULL;       // trace output, stdout by default
+const char *genSummary = NULL;   // sidecar output
+
+//------------------------------------//
+//      Generator Data Structures     //
+//------------------------------------//
+
+#define SITE_BIASED 0
+#define SITE_LOOP 1
+#define SITE_CORRELATED 2
+
+#define AFTER_NONE 0
+#define AFTER_CALL 1
+#define AFTER_JUMP 2
+
+#define SITES_PER_FUNCTION 16
+
+typedef struct
+{
+  uint32_t pc;
+  uint32_t target;
+  uint8_t kind;
+  uint8_t after;       // record emitted after the branch falls through
+  uint8_t indirect;    // the call/jump after the branch is indirect
+  uint8_t invert;      // correlated: outcome is the inverted history bit
+  uint32_t taken;      // biased: P(taken) scaled to 2^32
+  uint32_t trip;       // loop: iterations per visit
+  uint32_t span;       // loop: sites in the body, jumped back over when taken
+  uint32_t skip;       // otherwise: sites skipped forward when taken
+  uint32_t distance;   // correlated: global history bit copied
+  uint32_t callee;     // call: function called (first of genFanout if indirect)
+  uint32_t jumpPC;     // call/jump: pc of the unconditional record
+} genSite;
+
+typedef struct
+{
+  uint32_t first; // first site
+  uint32_t count; // number of sites
+  uint32_t entry; // entry pc, target of calls
+  uint32_t retPC; // pc of the return instruction
+} genFunction;
+
+typedef struct
+{
+  uint32_t function;
+  uint32_t site; // next site to execute, relative to the function
+  // loop sites: iterations done in the current visit. Kept per call so
+  // a recursive call counts its own loops, not its caller's
+  uint32_t iteration[SITES_PER_FUNCTION];
+} genFrame;
+
+std::vector<genSite> sites;
+std::vector<genFunction> functions;
+
+uint64_t rngState;
+
+// Record counters for the sidecar
+uint64_t numConditional, numUnconditional, numCall, numRet;
+
+//------------------------------------//
+//        Random Number Source        //
+//------------------------------------//
+
+static inline uint64_t rng_next()
+{
+  // splitmix64
+  uint64_t z = (rngState += 0x9e3779b97f4a7c15ULL);
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  return z ^ (z >> 31);
+}
+
+static inline uint32_t rng_below(uint64_t n) // n <= 2^32
+{
+  return (uint32_t)(((rng_next() >> 32) * n) >> 32);
+}
+
+static inline double rng_unit()
+{
+  return (rng_next() >> 11) * (1.0 / 9007199254740992.0);
+}
+
+//------------------------------------//
+//          Output Buffering          //
+//------------------------------------//
+
+#define OUT_BUFFER (1 << 20)
+char outBuffer[OUT_BUFFER];
+size_t outUsed;
+FILE *outStream;
+
+static inline char *put_hex(char *p, uint32_t value)
+{
+  static const char digits[] = "0123456789abcdef";
+  *p++ = '0';
+  *p++ = 'x';
+  int shift = 28;
+  while (shift > 0 && ((value >> shift) & 0xf) == 0)
+    shift -= 4;
+  for (; shift >= 0; shift -= 4)
+    *p++ = digits[(value >> shift) & 0xf];
+  return p;
+}
+
+// Append one record: pc, target, outcome, condition, call, ret, direct
+//
+static inline void emit(uint32_t pc, uint32_t target, int outcome, int condition, int call, int ret, int direct)
+{
+  if (outUsed > OUT_BUFFER - 64)
+  {
+    fwrite(outBuffer, 1, outUsed, outStream);
+    outUsed = 0;
+  }
+  char *p = outBuffer + outUsed;
+  p = put_hex(p, pc);
+  *p++ = '\t';
+  p = put_hex(p, target);
+  p[0] = '\t';
+  p[1] = '0' + outcome;
+  p[2] = '\t';
+  p[3] = '0' + condition;
+  p[4] = '\t';
+  p[5] = '0' + call;
+  p[6] = '\t';
+  p[7] = '0' + ret;
+  p[8] = '\t';
+  p[9] = '0' + direct;
+  p[10] = '\n';
+  outUsed = p + 11 - outBuffer;
+
+  if (condition)
+    numConditional++;
+  else
+    numUnconditional++;
+  numCall += call;
+  numRet += ret;
+}
+
+//------------------------------------//
+//        Program Construction        //
+//------------------------------------//
+
+static void build_program()
+{
+  uint32_t numFunctions = (genStatic + SITES_PER_FUNCTION - 1) / SITES_PER_FUNCTION;
+  uint32_t base = 0x400000;
+
+  sites.resize(genStatic);
+  functions.resize(numFunctions);
+  for (uint32_t f = 0; f < numFunctions; f++)
+  {
+    genFunction *fn = &functions[f];
+    fn->first = f * SITES_PER_FUNCTION;
+    fn->count = (fn->first + SITES_PER_FUNCTION <= genStatic) ? SITES_PER_FUNCTION : genStatic - fn->first;
+    fn->entry = base + f * 0x1000;
+    fn->retPC = fn->entry + 0x20 * fn->count + 0x10;
+
+    uint32_t bodyStart = 0; // loops never overlap: a body starts after the previous loop
+    for (uint32_t s = 0; s < fn->count; s++)
+    {
+      genSite *site = &sites[fn->first + s];
+      memset(site, 0, sizeof(*site));
+      site->pc = fn->entry + 0x20 * s + 0x8;
+      // forward skip over up to two sites, at most to the return
+      site->skip = 1 + rng_below(3);
+      if (s + site->skip > fn->count)
+        site->skip = fn->count - s;
+      site->target = site->pc + 0x20 * site->skip;
+      if (s + site->skip == fn->count)
+        site->target = fn->retPC;
+
+      double kind = rng_unit();
+      if (kind < genLoops)
+      {
+        site->kind = SITE_LOOP;
+        site->trip = genTripMin + rng_below((uint64_t)genTripMax - genTripMin + 1);
+        site->span = s - bodyStart;
+        site->target = fn->entry + 0x20 * bodyStart + 0x8;
+        bodyStart = s + 1;
+      }
+      else if (kind < genLoops + genCorrelated)
+      {
+        site->kind = SITE_CORRELATED;
+        site->distance = rng_below(genCorrDepth);
+        site->invert = rng_below(2);
+      }
+      else
+      {
+        site->kind = SITE_BIASED;
+        double p = rng_unit();
+        if (rng_unit() < genBiased)
+        {
+          p = 0.95 + 0.05 * p; // strongly biased, one way or the other
+          if (rng_below(2))
+            p = 1 - p;
+        }
+        site->taken = (uint32_t)(p * 4294967295.0);
+      }
+
+      double after = rng_unit();
+      site->jumpPC = site->pc + 0x10;
+      if (after < genCalls)
+      {
+        site->after = AFTER_CALL;
+        site->callee = rng_below(numFunctions);
+      }
+      else if (after < genCalls + genJumps)
+      {
+        site->after = AFTER_JUMP;
+      }
+      site->indirect = (site->after != AFTER_NONE) && rng_unit() < genIndirect;
+    }
+  }
+}
+
+//------------------------------------//
+//          Program Execution         //
+//------------------------------------//
+
+static void run_program()
+{
+  std::vector<genFrame> stack;
+  stack.reserve(genCallDepth + 1);
+  stack.push_back({0, 0});
+  uint64_t ghistory = 0;
+
+  while (numConditional < genBranches)
+  {
+    genFrame *frame = &stack.back();
+    genFunction *fn = &functions[frame->function];
+
+    if (frame->site == fn->count)
+    {
+      // end of the function: return, or restart the outermost one
+      if (stack.size() > 1)
+      {
+        stack.pop_back();
+        genFrame *caller = &stack.back();
+        genSite *callSite = &sites[functions[caller->function].first + caller->site - 1];
+        emit(fn->retPC, callSite->jumpPC + 0x8, 1, 0, 0, 1, 0);
+      }
+      else
+      {
+        frame->site = 0;
+      }
+      continue;
+    }
+
+    genSite *site = &sites[fn->first + frame->site];
+    int outcome;
+    switch (site->kind)
+    {
+    case SITE_LOOP:
+      outcome = (++frame->iteration[frame->site] < site->trip);
+      if (!outcome)
+        frame->iteration[frame->site] = 0;
+      break;
+    case SITE_CORRELATED:
+      outcome = ((ghistory >> site->distance) & 1) ^ site->invert;
+      break;
+    default:
+      outcome = (rng_next() >> 32) < site->taken;
+      break;
+    }
+    emit(site->pc, site->target, outcome, 1, 0, 0, 1);
+    ghistory = (ghistory << 1) | outcome;
+
+    if (outcome)
+    {
+      if (site->kind == SITE_LOOP)
+        frame->site -= site->span; // back to the top of the loop body
+      else
+      {
+        // skipping past a loop-closing branch leaves its loop: the next visit counts from the start
+        for (uint32_t s = frame->site + 1; s < frame->site + site->skip; s++)
+          if (sites[fn->first + s].kind == SITE_LOOP)
+            frame->iteration[s] = 0;
+        frame->site += site->skip;
+      }
+      continue;
+    }
+    frame->site++;
+
+    if (site->after == AFTER_CALL && stack.size() <= genCallDepth)
+    {
+      uint32_t callee = site->callee;
+      if (site->indirect)
+        callee = (callee + rng_below(genFanout)) % functions.size();
+      emit(site->jumpPC, functions[callee].entry, 1, 0, 1, 0, !site->indirect);
+      stack.push_back({callee, 0});
+    }
+    else if (site->after == AFTER_JUMP)
+    {
+      // direct jumps go to the next site; indirect ones to one of genFanout landing pads
+      uint32_t target = site->jumpPC + 0x8;
+      if (site->indirect)
+        target = site->jumpPC + 0x100000 + 0x10 * rng_below(genFanout);
+      emit(site->jumpPC, target, 1, 0, 0, 0, !site->indirect);
+    }
+  }
+}
+
+// Print out the Usage information to stderr
+//
+void usage()
+{
+  fprintf(stderr, "Usage: tracegen <options>\n");
+  fprintf(stderr, " Options (defaults in brackets):\n");
+  fprintf(stderr, " --branches:<n>      Conditional branches to emit [10000000]\n");
+  fprintf(stderr, " --seed:<n>          Random seed [1]\n");
+  fprintf(stderr, " --static:<n>        Static conditional branches [1000]\n");
+  fprintf(stderr, " --biased:<f>        Fraction of strongly biased branches [0.7]\n");
+  fprintf(stderr, " --loops:<f>         Fraction of loop-closing branches [0.1]\n");
+  fprintf(stderr, " --trip:<min>:<max>  Loop trip count range [4:64]\n");
+  fprintf(stderr, " --correlated:<f>    Fraction of history-correlated branches [0.1]\n");
+  fprintf(stderr, " --corr-depth:<n>    Maximum correlation distance, <= 64 [16]\n");
+  fprintf(stderr, " --calls:<f>         Chance of a call after a branch [0.05]\n");
+  fprintf(stderr, " --call-depth:<n>    Maximum call nesting [16]\n");
+  fprintf(stderr, " --jumps:<f>         Chance of a jump after a branch [0.05]\n");
+  fprintf(stderr, " --indirect:<f>      Fraction of indirect calls and jumps [0.2]\n");
+  fprintf(stderr, " --fanout:<n>        Targets per indirect call or jump [4]\n");
+  fprintf(stderr, " --insts:<n>         Instructions per record, for the summary [5]\n");
+  fprintf(stderr, " --out:<file>        Trace output [stdout]\n");
+  fprintf(stderr, " --summary:<file>    Write the .txt summary sidecar\n");
+}
+
+// Process an option and update the generator
+// configuration variables accordingly
+//
+// Returns True if Successful
+//
+int handle_option(char *arg)
+{
+  unsigned long long n;
+  if (sscanf(arg, "--branches:%llu", &n) == 1)
+    genBranches = n;
+  else if (sscanf(arg, "--seed:%llu", &n) == 1)
+    genSeed = n;
+  else if (sscanf(arg, "--static:%u", &genStatic) == 1)
+    ;
+  else if (sscanf(arg, "--biased:%lf", &genBiased) == 1)
+    ;
+  else if (sscanf(arg, "--loops:%lf", &genLoops) == 1)
+    ;
+  else if (sscanf(arg, "--trip:%u:%u", &genTripMin, &genTripMax) == 2)
+    ;
+  else if (sscanf(arg, "--correlated:%lf", &genCorrelated) == 1)
+    ;
+  else if (sscanf(arg, "--corr-depth:%u", &genCorrDepth) == 1)
+    ;
+  else if (sscanf(arg, "--calls:%lf", &genCalls) == 1)
+    ;
+  else if (sscanf(arg, "--call-depth:%u", &genCallDepth) == 1)
+    ;
+  else if (sscanf(arg, "--jumps:%lf", &genJumps) == 1)
+    ;
+  else if (sscanf(arg, "--indirect:%lf", &genIndirect) == 1)
+    ;
+  else if (sscanf(arg, "--fanout:%u", &genFanout) == 1)
+    ;
+  else if (sscanf(arg, "--insts:%u", &genInsts) == 1)
+    ;
+  else if (!strncmp(arg, "--out:", 6))
+    genOut = arg + 6;
+  else if (!strncmp(arg, "--summary:", 10))
+    genSummary = arg + 10;
+  else
+    return 0;
+  return 1;
+}
+
+int main(int argc, char *argv[])
+{
+  for (int i = 1; i < argc; ++i)
+  {
+    if (!strcmp(argv[i], "--help"))
+    {
+      usage();
+      exit(0);
+    }
+    if (!handle_option(argv[i]))
+    {
+      fprintf(stderr, "Unrecognized option %s\n", argv[i]);
+      usage();
+      exit(1);
+    }
+  }
+  if (genStatic == 0 || genFanout == 0 || genTripMin == 0 || genTripMax < genTripMin || genCorrDepth == 0 || genCorrDepth > 64)
+  {
+    fprintf(stderr, "Invalid configuration\n");
+    exit(1);
+  }
+
+  outStream = genOut ? fopen(genOut, "w") : stdout;
+  if (outStream == NULL)
+  {
+    fprintf(stderr, "Cannot write %s\n", genOut);
+    exit(1);
+  }
+
+  rngState = genSeed;
+  build_program();
+  run_program();
+  fwrite(outBuffer, 1, outUsed, outStream);
+  if (genOut)
+    fclose(outStream);
+
+  if (genSummary)
+  {
+    FILE *summary = fopen(genSummary, "w");
+    if (summary == NULL)
+    {
+      fprintf(stderr, "Cannot write %s\n", genSummary);
+      exit(1);
+    }
+    fprintf(summary, "!!! Number of Instructions = %llu\n", (unsigned long long)((numConditional + numUnconditional) * genInsts));
+    fprintf(summary, "!!! Number of Unconditional branches = %llu\n", (unsigned long long)numUnconditional);
+    fprintf(summary, "!!! Number of Conditional branches = %llu\n", (unsigned long long)numConditional);
+    fprintf(summary, "!!! Number of Call branches = %llu\n", (unsigned long long)numCall);
+    fprintf(summary, "!!! Number of Ret branches = %llu\n", (unsigned long long)numRet);
+    fclose(summary);
+  }
+  return 0;
+}